@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+// Adaptive acquisition controller. Switches the INA219 between a fast,
+// unaveraged mode while the current is moving and a slow, heavily averaged
+// mode while it is flat, and decimates the report stream accordingly.
+
+#define ADAPT_MODE_SLOW 0
+#define ADAPT_MODE_FAST 1
+
+// Returned by ADAPT_Update
+#define ADAPT_EVENT_MODE 0x01   // mode changed, apply ADAPT_GetProfile()
+#define ADAPT_EVENT_REPORT 0x02 // averaged report ready in shunt/bus
+
+typedef struct ADAPT_Profile {
+  uint16_t config;   // INA219 configuration register value
+  uint16_t interval; // ms between samples, >= conversion time
+  uint8_t decimate;  // samples averaged into one report
+} ADAPT_Profile;
+
+typedef struct ADAPT_Config {
+  ADAPT_Profile profiles[2]; // indexed by ADAPT_MODE_*
+  int32_t delta;             // mA step between samples that triggers fast mode
+  int32_t variance;          // mA^2 running variance that triggers fast mode
+  uint16_t holdoff;          // quiet samples before backing off to slow mode
+} ADAPT_Config;
+
+typedef struct ADAPT_Controller {
+  const ADAPT_Config *config;
+  uint8_t mode;
+  uint8_t count;   // samples in the running report
+  uint16_t quiet;  // consecutive quiet samples
+  int32_t last;    // previous current sample, mA
+  int32_t mean;    // running mean, mA << 4
+  int32_t var;     // running variance, mA^2
+  int32_t shuntSum;
+  int32_t busSum;
+  int32_t shunt;   // last report: averaged shunt register value
+  int32_t bus;     // last report: averaged bus register value
+  uint32_t switches;
+} ADAPT_Controller;
+
+extern const ADAPT_Config ADAPT_DefaultConfig;
+
+void ADAPT_Init(ADAPT_Controller *ctl, const ADAPT_Config *config);
+// Feeds one raw sample and its current (mA). Returns ADAPT_EVENT_* flags.
+uint8_t ADAPT_Update(ADAPT_Controller *ctl, int16_t shunt, int16_t bus,
+                     int32_t current);
+// Forces fast mode, e.g. while another channel is moving. Returns
+// ADAPT_EVENT_MODE if the mode changed.
+uint8_t ADAPT_Boost(ADAPT_Controller *ctl);
+// Returns the profile of the active mode.
+const ADAPT_Profile *ADAPT_GetProfile(const ADAPT_Controller *ctl);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "main.h"
+
+// Over-current / over-power watchdog. Runs in the sampling path on raw
+// INA219 register values, so a trip costs one compare per sample and happens
+// before any formatting, printing or display work.
+//
+// Worst-case reaction time, from the load exceeding the limit to the alarm
+// GPIO going active, with the default profiles (simulated against a model of
+// the INA219 by Tools/meas, meassim check):
+// - fast mode: 3.6ms. One 2ms interval, plus up to three 532us conversions
+//   until one holds only the new current.
+// - slow mode, within 3/4 of a limit: as fast mode. ALARM_EVENT_NEAR boosts
+//   acquisition to fast mode and keeps it there.
+// - slow mode, below 3/4 of the limits: 60ms, within the 100ms of a fixed
+//   loop. A step only shows once a 17ms averaged conversion (AVG32) holds
+//   enough of it, read at the next 35ms interval, up to 55ms late. The step
+//   then boosts to fast mode and the next fast sample trips. The default
+//   slow profile is only this short while an alarm limit is set, see
+//   APP_SLOW_MS; raising slow_ms or slow_adc gives the bound up.
+// On top of that come:
+// t_read:  one 16-bit register read over SWIIC, about 250us at delay = 10
+// t_over:  loops that take longer than the sample interval, seen at runtime
+//          in ALARM_Monitor.maxGap (dominated by display updates, which are
+//          sent SSD1306_CHUNK bytes per loop, see UI_Poll)
+// The trip itself (compare and GPIO write) takes well under 1us.
+
+// Optional alarm output, e.g.
+// #define ALARM_GPIO_PORT GPIOA
+// #define ALARM_GPIO_PIN LL_GPIO_PIN_0
+// #define ALARM_GPIO_ACTIVE_LOW
+
+#define ALARM_CAUSE_CURRENT 0x01
+#define ALARM_CAUSE_POWER 0x02
+
+// Returned by ALARM_CheckShunt / ALARM_CheckPower
+#define ALARM_EVENT_TRIP 0x01
+#define ALARM_EVENT_CLEAR 0x02
+#define ALARM_EVENT_NEAR 0x04 // above 3/4 of a limit, keep sampling fast
+
+typedef struct ALARM_Monitor {
+  int32_t shuntLimit; // shunt register value, absolute
+  int32_t powerLimit; // product of shunt and bus register values, absolute
+  uint8_t cause;      // ALARM_CAUSE_* bits while active, 0 when idle
+  uint8_t checked;    // lastCheck is valid
+  uint32_t lastCheck; // us
+  uint32_t maxGap;    // us, longest interval between two shunt checks
+  uint32_t trips;
+} ALARM_Monitor;
+
+// Limits are in raw register units; 0 disables a limit.
+void ALARM_Init(ALARM_Monitor *mon, int32_t shuntLimit, int32_t powerLimit);
+// Checks the shunt register value sampled at time (us).
+uint8_t ALARM_CheckShunt(ALARM_Monitor *mon, int16_t shunt, uint32_t time);
+// Checks the power after the bus voltage of the same sample is known, and
+// releases the alarm once both values are back below 7/8 of their limits.
+uint8_t ALARM_CheckPower(ALARM_Monitor *mon, int16_t shunt, int16_t bus);
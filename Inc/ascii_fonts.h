@@ -11,6 +11,25 @@ typedef struct {
     const uint8_t *data;
 } FontDef_t;
 
+/* Font in the SSD1306 native layout, generated at build time from the fonts
+ * below by Tools/fontgen.py. Each glyph is stored as `pages` runs of
+ * width[i] bytes, one vertical byte per column with the LSB on top, and
+ * run-length coded if PAGEFONT_RLE is set. */
+#define PAGEFONT_RLE 0x01
+/* Largest glyph (width * pages) of an RLE font */
+#define PAGEFONT_MAX_GLYPH 64
+
+typedef struct {
+    uint8_t height;
+    uint8_t pages;
+    uint8_t count;
+    uint8_t flags;
+    const char *chars;
+    const uint16_t *offset;
+    const uint8_t *width;
+    const uint8_t *data;
+} PageFontDef_t;
+
 extern FontDef_t Font_3x5;
 extern FontDef_t Font_5x7;
 extern FontDef_t Font_6x8;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "uart.h"
+
+// Serial rate negotiation. The host asks for a rate, the device answers at
+// the old rate with the rate its divider actually reaches and the error,
+// waits until the answer is out and switches. The host switches as well and
+// confirms at the new rate. Without a confirmation within BAUD_CONFIRM_TIME
+// the device goes back to the old rate, so a USB bridge that cannot follow
+// never loses the link:
+//
+//   host: baud 921600
+//   dev:  baud 921600 actual 923077 error 0.16%    at the old rate
+//   host: baud ok                                  at the new rate
+//   dev:  baud ok 921600
+// or, without the confirmation:
+//   dev:  baud fallback 115200                     at the old rate
+//
+// A rate off by more than BAUD_MAX_ERROR or beyond clock / 16 is refused
+// with "baud refused", "baud" alone reports the current rate. Output is held
+// from the answer to the confirmation or fallback.
+
+#ifndef BAUD_CONFIRM_TIME
+#define BAUD_CONFIRM_TIME 1000 // ms
+#endif
+// Largest rate error accepted, in 0.01%
+#ifndef BAUD_MAX_ERROR
+#define BAUD_MAX_ERROR 200
+#endif
+// Longest reply: "baud refused 4294967295 actual 1500000 error -99.99%\n"
+#define BAUD_REPLY_LEN 56
+
+#define BAUD_STATE_IDLE 0
+#define BAUD_STATE_ACK 1     // answer queued, switch once it is out
+#define BAUD_STATE_CONFIRM 2 // switched, waiting for the host
+
+typedef struct BAUD_Link {
+  uint32_t rate;      // nominal rate in use, or being switched to
+  uint32_t previous;  // rate to fall back to
+  uint32_t since;     // ms, start of the wait for the confirmation
+  uint32_t switches;  // confirmed changes
+  uint32_t fallbacks; // changes undone for lack of a confirmation
+  uint8_t state;      // BAUD_STATE_*
+  // Output of the replies, the same as the shell's so they are framed like
+  // its lines. Returns 0 if there was no room for the reply.
+  uint16_t (*write)(const void *data, uint16_t len);
+} BAUD_Link;
+
+void BAUD_Init(BAUD_Link *link, uint32_t rate,
+               uint16_t (*write)(const void *data, uint16_t len));
+// Handles the "baud" command, arg is the text after it: a rate, "ok" or "".
+// Writes its replies itself, each in one write.
+void BAUD_Command(BAUD_Link *link, const char *arg);
+// Advances the handshake, call from the main loop.
+void BAUD_Poll(BAUD_Link *link, uint32_t now);
+// Error of the actual rate against the requested one, in 0.01%.
+int32_t BAUD_Error(uint32_t requested, uint32_t actual);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#ifdef USE_DSP
+#include "arm_math.h"
+#endif
+
+// Low-pass filter for raw shunt register samples in fast mode, where the
+// INA219 does no averaging of its own. Second-order Butterworth at fs / 20.
+// With use_dsp it runs on the CMSIS-DSP q31 biquad kernel, otherwise on a
+// hand-written 16-bit integer biquad with error feedback.
+
+typedef struct FILTER_State {
+#ifdef USE_DSP
+  arm_biquad_casd_df1_inst_q31 instance;
+  q31_t dspState[4];
+#endif
+  int16_t state[4]; // x[n-1], x[n-2], y[n-1], y[n-2]
+  int32_t error;    // truncation error fed back into the next sample
+} FILTER_State;
+
+void FILTER_Init(FILTER_State *filter);
+// Presets the filter history to a steady input value.
+void FILTER_Reset(FILTER_State *filter, int16_t value);
+// Filters one sample.
+int16_t FILTER_Update(FILTER_State *filter, int16_t sample);
+// Measures and returns the cost of FILTER_Update in CPU cycles per sample,
+// and of the hand-written kernel in *integer if not NULL.
+uint32_t FILTER_Benchmark(uint32_t *integer);
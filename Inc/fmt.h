@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+// Fixed-point number formatting for the display path. No libc and no
+// allocation: output goes straight into the caller's buffer, which needs
+// room for width characters (or the natural length, if longer) plus NUL.
+
+// Writes value / 10^scale with the given number of decimals, rounded half
+// away from zero, followed by unit. Leading zeros of the fraction are kept
+// (1005 milli-units with 3 decimals is "1.005"). The result is right-aligned
+// with spaces to width characters. Returns a pointer to the terminating NUL.
+char *FMT_Fixed(char *buf, int32_t value, uint8_t scale, uint8_t decimals,
+                uint8_t width, const char *unit);
+
+// Writes a milli-unit value with an automatically chosen prefix and about
+// four significant digits: "523mA", "1.234A", "12.35A", "123.4A".
+char *FMT_Auto(char *buf, int32_t milli, uint8_t width, const char *unit);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ssd1306.h"
+
+// Scrolling trend graph. Samples are folded into columns (min/max envelope
+// of all samples in the column) kept in a ring buffer. Rendering shifts the
+// graph area of the framebuffer left and draws only the new columns; the
+// whole graph is redrawn only when the Y axis is rescaled or the screen was
+// cleared.
+//
+// The SSD1306 hardware scroll is not used: it runs on its own frame clock,
+// so it cannot be stepped by exactly one column per sample, and the panel RAM
+// has to be rewritten after stopping it anyway.
+
+// Columns kept, and shown, right-aligned on the panel. Leaves 42 columns on
+// the left for the axis labels of main.c: seven 6x8 glyphs, a current
+// right-aligned to six and its unit
+#ifndef GRAPH_WIDTH
+#define GRAPH_WIDTH 86
+#endif
+#define GRAPH_X (SSD1306_WIDTH - GRAPH_WIDTH)
+#define GRAPH_HEIGHT SSD1306_HEIGHT
+// Smallest span of the Y axis, keeps noise on a flat signal from filling the
+// whole graph
+#ifndef GRAPH_MIN_SPAN
+#define GRAPH_MIN_SPAN 20
+#endif
+
+// Define GRAPH_SWEEP to draw new columns in place with a moving gap, like an
+// oscilloscope in roll-off mode. Only two columns change per update instead
+// of the whole graph area, for slow buses.
+// #define GRAPH_SWEEP
+
+typedef struct GRAPH_Trend {
+  int16_t min[GRAPH_WIDTH];
+  int16_t max[GRAPH_WIDTH];
+  uint8_t head;   // next ring slot to write
+  uint8_t count;  // valid columns
+  uint8_t stale;  // columns pushed since the last render
+  uint8_t redraw; // scale changed or screen cleared
+  uint8_t open;   // the running column holds samples
+  int16_t colMin; // running column
+  int16_t colMax;
+  int16_t dataMin; // extremes of the columns in the ring
+  int16_t dataMax;
+  int16_t lo; // Y axis range
+  int16_t hi;
+} GRAPH_Trend;
+
+void GRAPH_Init(GRAPH_Trend *graph);
+// Adds a sample to the running column.
+void GRAPH_Add(GRAPH_Trend *graph, int32_t value);
+// Closes the running column, rescaling the Y axis if needed. Does nothing if
+// no sample was added since the last call.
+void GRAPH_Push(GRAPH_Trend *graph);
+// Renders pending columns into the framebuffer. Returns the number of
+// columns drawn; in SSD1306_PAGE_MODE only the number of columns pending.
+uint8_t GRAPH_Render(GRAPH_Trend *graph);
+// Draws the whole graph, a UI_Item draw function.
+void GRAPH_Draw(void *graph);
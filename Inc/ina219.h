@@ -11,6 +11,21 @@
 #define INA219_REG_CURRENT 0x04
 #define INA219_REG_CALIBRATION 0x05
 
+// Configuration register fields
+#define INA219_CONF_BRNG_32V (1 << 13)
+#define INA219_CONF_PG_160MV (2 << 11)
+#define INA219_CONF_MODE_CONTINUOUS 0x07
+// ADC resolution / averaging, conversion time in comment
+#define INA219_ADC_12BIT 0x3   // 532us
+#define INA219_ADC_AVG2 0x9    // 1.06ms
+#define INA219_ADC_AVG8 0xB    // 4.26ms
+#define INA219_ADC_AVG32 0xD   // 17.02ms
+#define INA219_ADC_AVG128 0xF  // 68.10ms
+#define INA219_CONFIG(badc, sadc)                                              \
+  (INA219_CONF_BRNG_32V | INA219_CONF_PG_160MV | ((badc) << 7) |              \
+   ((sadc) << 3) | INA219_CONF_MODE_CONTINUOUS)
+
 void INA219_Init(SWIIC_Config *swiic);
+void INA219_SetConfig(uint16_t config);
 int16_t INA219_ReadShuntVoltage(void); // 16-bit signed integer in 10uV
 int16_t INA219_ReadBusVoltage(void); // 16-bit unsigned integer in 4mV
\ No newline at end of file
@@ -48,9 +48,11 @@ extern "C" {
 /* Private includes ----------------------------------------------------------*/
 /* Private defines -----------------------------------------------------------*/
 /* Exported variables prototypes ---------------------------------------------*/
+extern volatile uint32_t APP_TickMs;
 /* Exported functions prototypes ---------------------------------------------*/
 void APP_I2C_Transmit(uint8_t devAddress, uint8_t memAddress, uint8_t *pData, uint16_t len);
 void APP_ErrorHandler(void);
+uint32_t APP_GetMicros(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+// Periodic-load detector. Locks onto duty-cycled loads (radio beacons, LED
+// PWM, charger pulses) by tracking threshold crossings of the current with an
+// adaptive envelope, and reports per-cycle statistics. Integer only.
+
+// Minimum peak-to-peak swing (mA) before the detector tries to lock
+#ifndef PERIOD_MIN_SWING
+#define PERIOD_MIN_SWING 20
+#endif
+// Envelope decay per sample, as a right shift of the current swing
+#ifndef PERIOD_DECAY_SHIFT
+#define PERIOD_DECAY_SHIFT 6
+#endif
+// Consecutive matching cycles required to report a lock
+#ifndef PERIOD_LOCK_CYCLES
+#define PERIOD_LOCK_CYCLES 3
+#endif
+
+typedef struct PERIOD_Result {
+  uint32_t period;   // us
+  uint16_t duty;     // high time in 1/1000 of the period
+  int32_t average;   // mA, time-weighted over the cycle
+  int32_t peak;      // mA
+  uint32_t cycles;   // number of cycles measured so far
+} PERIOD_Result;
+
+typedef struct PERIOD_Detector {
+  int32_t high;      // envelope maximum, mA << PERIOD_DECAY_SHIFT
+  int32_t low;       // envelope minimum, mA << PERIOD_DECAY_SHIFT
+  int32_t last;      // previous sample
+  uint32_t lastTime; // timestamp of the previous sample
+  uint32_t riseTime; // timestamp of the last rising edge
+  uint32_t fallTime; // timestamp of the last falling edge
+  int64_t sum;       // integral of current over the running cycle, mA*us
+  int32_t peak;      // peak of the running cycle
+  uint8_t state;     // see PERIOD_STATE_*
+  uint8_t lock;      // matching cycles in a row
+  uint8_t primed;    // a rising edge has been seen
+  uint8_t started;   // at least one sample has been seen
+  PERIOD_Result result;
+} PERIOD_Detector;
+
+#define PERIOD_STATE_LOW 0
+#define PERIOD_STATE_HIGH 1
+
+// Resets the detector.
+void PERIOD_Init(PERIOD_Detector *det);
+// Feeds a sample taken at time (us). Returns 1 when a cycle completes and
+// det->result has been updated.
+uint8_t PERIOD_Update(PERIOD_Detector *det, uint32_t time, int32_t current);
+// Returns 1 if the last PERIOD_LOCK_CYCLES periods agree within 1/8.
+uint8_t PERIOD_IsLocked(const PERIOD_Detector *det);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ssd1306.h"
+
+// Seven-segment digits of any height up to 32 pixels, built from segment
+// rectangles instead of bitmaps. A cell has only three distinct columns (left
+// stroke, middle, right stroke), so a digit is computed as three column masks
+// and written with SSD1306_FillRuns, one pass per page. A 32 pixel
+// readout costs a 10 byte segment table rather than a large font.
+//
+// Characters: 0-9, '-', ' ' take a digit cell, '.' a narrow one. Anything
+// else draws as a blank digit cell.
+
+// Longest text of a field, without NUL
+#ifndef SEG7_FIELD_LEN
+#define SEG7_FIELD_LEN 7
+#endif
+
+typedef struct SEG7_Field {
+  uint8_t x;
+  uint8_t y;
+  uint8_t height;
+  uint8_t end; // column after the last rendered character
+  char text[SEG7_FIELD_LEN + 1];
+} SEG7_Field;
+
+// Advance of a character, including the space after it.
+uint8_t SEG7_CharWidth(char ch, uint8_t height);
+// Width of a text, for right alignment.
+uint8_t SEG7_TextWidth(const char *text, uint8_t height);
+// Draws a character with its top left corner at (x, y), writing the whole
+// cell including the space after it. Returns the advance.
+uint8_t SEG7_DrawChar(int16_t x, int16_t y, uint8_t height, char ch);
+
+void SEG7_InitField(SEG7_Field *field, uint8_t x, uint8_t y, uint8_t height);
+// Sets the text of a field, redrawing only the segments that changed.
+// Returns the number of characters that changed.
+uint8_t SEG7_SetText(SEG7_Field *field, const char *text);
+// UI_Item draw function for a SEG7_Field.
+void SEG7_DrawField(void *field);
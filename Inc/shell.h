@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+
+// Line-oriented command shell for the serial port. Bytes are fed one at a
+// time from the receive ring at constant cost; a complete line is split into
+// words and dispatched from the main loop, never from the interrupt or the
+// sampling path. Grammar:
+//
+//   line     = word *(" " word) ("\n" | "\r" | "\r\n")
+//   get [name]          "<name> <value>" for one or all variables
+//   set <name> <value>  "ok" or "error: <reason>"
+//   help                the commands and variables
+//   <command> [args]    commands of the application
+//
+// Words are separated by spaces, a line of more than SHELL_LINE_LEN
+// characters is dropped whole with "error: line too long". Every reply line
+// ends with "\n". Replies are produced a line at a time and a line the output
+// buffer has no room for is sent on a later SHELL_Execute, so a long reply
+// never blocks and is never cut; input waits until it is out.
+
+#ifndef SHELL_LINE_LEN
+#define SHELL_LINE_LEN 31
+#endif
+#ifndef SHELL_MAX_ARGS
+#define SHELL_MAX_ARGS 4
+#endif
+// Longest reply line, without the "\n"
+#define SHELL_REPLY_LEN 48
+
+// Returned by SHELL_Handler
+#define SHELL_DONE 0  // reply holds the last line, or is empty for none
+#define SHELL_MORE 1  // reply holds a line, call again with index + 1
+#define SHELL_USAGE 2 // bad arguments, only at index 0
+
+// Runs a command. Index 0 is the first call, which does the work; every
+// call writes reply line index into reply as a string.
+typedef uint8_t (*SHELL_Handler)(uint8_t argc, char **argv, uint8_t index,
+                                 char *reply);
+
+typedef struct SHELL_Var {
+  const char *name;
+  int32_t *value;
+  int32_t min;
+  int32_t max;
+  // Names of the values min..max, or NULL for a decimal number
+  const char *const *names;
+} SHELL_Var;
+
+typedef struct SHELL_Command {
+  const char *name;
+  const char *usage; // arguments, for help
+  SHELL_Handler run; // argv[0] is the command name
+} SHELL_Command;
+
+typedef struct SHELL_Config {
+  const SHELL_Command *commands;
+  uint8_t commandCount;
+  const SHELL_Var *vars;
+  uint8_t varCount;
+  // Called after set changed a variable
+  void (*changed)(const SHELL_Var *var);
+  // Output of the replies, a write is a whole line. Returns 0 if there was
+  // no room for it.
+  uint16_t (*write)(const void *data, uint16_t len);
+} SHELL_Config;
+
+typedef struct SHELL_State {
+  const SHELL_Config *config;
+  char line[SHELL_LINE_LEN + 1];
+  uint8_t len;    // characters in line, SHELL_LINE_LEN + 1 once too long
+  uint8_t ready;  // line holds a complete command
+  uint8_t busy;   // its reply is not out yet, input waits
+  // Command being answered
+  SHELL_Handler run;
+  char *argv[SHELL_MAX_ARGS];
+  uint8_t argc;
+  uint8_t index;  // of the reply line in reply
+  uint8_t status; // SHELL_DONE or SHELL_MORE, after the line in reply
+  char reply[SHELL_REPLY_LEN + 2];
+  uint32_t lines;  // commands run
+  uint32_t errors; // lines answered with an error
+} SHELL_State;
+
+void SHELL_Init(SHELL_State *shell, const SHELL_Config *config);
+// Feeds one received byte. Returns 1 when it completes a line; further
+// bytes are ignored until SHELL_Execute has answered it.
+uint8_t SHELL_Input(SHELL_State *shell, uint8_t byte);
+// Runs the completed line and sends as much of its reply as fits. Returns 1
+// while the shell takes input, 0 while a reply is still waiting for room.
+uint8_t SHELL_Execute(SHELL_State *shell);
+// Parses a signed decimal number. Returns 0 if text is not one.
+uint8_t SHELL_ParseInt(const char *text, int32_t *value);
@@ -47,17 +47,71 @@ extern C {
 #define SSD1306_TIMEOUT					20000
 #endif
 
+/* Largest I2C data transaction of SSD1306_Poll, bounds the time the bus
+ * (shared with the sensor) is held per call */
+#ifndef SSD1306_CHUNK
+#define SSD1306_CHUNK            16
+#endif
+
+/* Define SSD1306_DOUBLE_BUFFER to send presented frames from a copy, so
+ * drawing the next frame never shows up half-done on the panel (+512 bytes
+ * of RAM) */
+
+/* Define SSD1306_PAGE_MODE to keep only one page (128 bytes) instead of the
+ * whole framebuffer. A frame is then drawn once per page between
+ * SSD1306_BeginPage and SSD1306_UpdateScreen/SSD1306_Present, with drawing
+ * outside of the page clipped, see UI_Flush */
+
+/* Returned by SSD1306_Present */
+#define SSD1306_PRESENT_IDLE     0 /* nothing changed */
+#define SSD1306_PRESENT_QUEUED   1 /* frame queued, send it with SSD1306_Poll */
+#define SSD1306_PRESENT_BUSY     2 /* previous frame still being sent */
+
 #define SSD1306_COLOR_BLACK 0x00
 #define SSD1306_COLOR_WHITE 0x01
+/* Toggles pixels, for FillRect highlight boxes */
+#define SSD1306_COLOR_INVERT 0x02
 
 uint8_t SSD1306_Init(void);
 void SSD1306_UpdateScreen(void);
+/* Non-blocking update: SSD1306_Present queues the changes since the last
+ * frame, each SSD1306_Poll call then sends at most SSD1306_CHUNK bytes and
+ * returns 0 once the frame is out */
+uint8_t SSD1306_Present(void);
+uint8_t SSD1306_Poll(void);
+uint16_t SSD1306_GetFrameBytes(void);
+#ifdef SSD1306_PAGE_MODE
+void SSD1306_BeginPage(uint8_t page);
+#endif
 void SSD1306_ToggleInvert(void);
+void SSD1306_InvertDisplay(uint8_t invert);
 void SSD1306_Fill(uint8_t Color);
 void SSD1306_DrawPixel(uint16_t x, uint16_t y, uint8_t color);
 void SSD1306_GotoXY(uint16_t x, uint16_t y);
 char SSD1306_Putc(char ch, FontDef_t* Font, uint8_t color);
 char SSD1306_Puts(char* str, FontDef_t* Font, uint8_t color);
+char SSD1306_PutcPaged(char ch, const PageFontDef_t* font, uint8_t color);
+char SSD1306_PutsPaged(const char* str, const PageFontDef_t* font, uint8_t color);
+/* Width in pixels of a string in a page-major font, for right alignment */
+uint16_t SSD1306_TextWidthPaged(const char* str, const PageFontDef_t* font);
+void SSD1306_DrawColumn(uint16_t x, uint16_t y, uint32_t bits, uint32_t mask);
+/* Writes the same column as SSD1306_DrawColumn into w adjacent columns, a
+ * span per page */
+void SSD1306_FillColumns(int16_t x, uint16_t y, int16_t w, uint32_t bits, uint32_t mask);
+/* Runs of identical columns side by side, for SSD1306_FillRuns */
+typedef struct {
+    uint8_t width;
+    uint32_t bits;
+} SSD1306_Run_t;
+/* Writes count runs from x on, each like SSD1306_FillColumns, in one pass
+ * per page */
+void SSD1306_FillRuns(int16_t x, uint16_t y, const SSD1306_Run_t* runs, uint8_t count, uint32_t mask);
+void SSD1306_ScrollLeft(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1, uint8_t n);
+void SSD1306_DrawHLine(int16_t x, int16_t y, int16_t w, uint8_t color);
+void SSD1306_DrawVLine(int16_t x, int16_t y, int16_t h, uint8_t color);
+void SSD1306_DrawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color);
+void SSD1306_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color);
+void SSD1306_DrawBar(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t value, uint16_t max);
 void SSD1306_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t c);
 void SSD1306_DrawCircle(int16_t x0, int16_t y0, int16_t r, uint8_t c);
 void SSD1306_Image(uint8_t *img, uint8_t frame, uint8_t x, uint8_t y);
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+
+// Binary sample records for the serial port. A record is a fixed
+// little-endian layout followed by a CRC-16, COBS encoded and terminated by
+// a 0x00 byte. COBS leaves no zero inside a frame, so a receiver that lost a
+// byte resyncs at the next 0x00. A sample costs 15 bytes on the wire instead
+// of about 90 bytes of text.
+//
+// Record version 1, byte offsets:
+//   0  version   TELEM_VERSION
+//   1  sequence  +1 per record, a gap means lost records
+//   2  time      uint32, us since boot
+//   6  shunt     int16, shunt voltage register, 10 uV per LSB
+//   8  bus       uint16, bus voltage register, 4 mV per LSB
+//   10 flags     TELEM_FLAG_*
+//   11 crc       uint16, CRC-16/CCITT-FALSE of the bytes before it
+//
+// Later versions only append fields before the CRC, so a decoder reads the
+// fields it knows from any record at least as long as its own version.
+// Versions stay below 0x80; a first byte of 0x80 or more is another kind of
+// record.
+//
+// Delta blocks (TELEM_KIND_BLOCK) carry up to TELEM_BLOCK_SAMPLES samples in
+// about a quarter of the bytes. Consecutive samples differ by a few LSBs, so
+// each is sent as the zig-zag varint difference to the one before. Every
+// block opens with a full sample, the keyframe, and is CRC-checked and
+// framed like a record, so a receiver loses at most one block and resyncs at
+// the next:
+//   0  kind      TELEM_KIND_BLOCK
+//   1  sequence  of the keyframe, the others follow +1 each
+//   2  count     samples in the block, keyframe included
+//   3  keyframe  time uint32, shunt int16, bus uint16, flags
+//   12 deltas    count - 1 of, each as varints:
+//                  zz(interval - previous interval), the first previous
+//                  interval being 0
+//                  zz(shunt difference) << 1 | 1 if a flags byte follows
+//                  zz(bus difference)
+//                  [flags]
+//   .. crc       uint16, as in a record
+// zz(x) maps 0, -1, 1, -2 ... to 0, 1, 2, 3 ..., a varint is 7 bits per byte,
+// least significant first, with the top bit set on all but the last byte.
+
+#define TELEM_VERSION 1
+#define TELEM_RECORD_SIZE 13
+// COBS adds one byte per 254, plus the 0x00 delimiter
+#define TELEM_FRAME_SIZE (TELEM_RECORD_SIZE + TELEM_RECORD_SIZE / 254 + 2)
+
+#define TELEM_KIND_BLOCK 0x80
+// Samples per block, and the longest time in us a sample waits in a block:
+// a block is closed early when the next sample would come later, so slow
+// sampling still reaches the host promptly
+#define TELEM_BLOCK_SAMPLES 16
+#define TELEM_BLOCK_TIME 50000
+// Block without its CRC. A block is closed while the largest delta, 12 bytes,
+// still fits; typical deltas take 3.
+#define TELEM_BLOCK_SIZE 80
+#define TELEM_BLOCK_FRAME_SIZE (TELEM_BLOCK_SIZE + 2 + 2)
+
+#define TELEM_FLAG_FAST 0x01   // sampled in the fast ADAPT mode
+#define TELEM_FLAG_REPORT 0x02 // sample closed a report window
+#define TELEM_FLAG_ALARM 0x04  // over-current or over-power alarm active
+#define TELEM_FLAG_VBUS 0x08   // bus voltage transition logged
+
+typedef struct TELEM_Sample {
+  uint32_t time;   // us
+  int16_t shunt;   // raw, 10 uV per LSB
+  uint16_t bus;    // raw, 4 mV per LSB
+  uint8_t flags;   // TELEM_FLAG_*
+  uint8_t sequence;
+} TELEM_Sample;
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), continuing from crc.
+uint16_t TELEM_Crc16(uint16_t crc, const uint8_t *data, uint16_t len);
+// COBS encodes len bytes of in and appends the 0x00 delimiter. out needs
+// room for len + len / 254 + 2 bytes. Returns the frame length.
+uint16_t TELEM_CobsEncode(uint8_t *out, const uint8_t *in, uint16_t len);
+// Writes the frame of a sample, TELEM_FRAME_SIZE bytes at most. Returns its
+// length.
+uint8_t TELEM_EncodeSample(uint8_t *frame, const TELEM_Sample *sample);
+
+typedef struct TELEM_Block {
+  uint8_t data[TELEM_BLOCK_SIZE + 2]; // record, and room for its CRC
+  uint8_t len;                        // bytes in data
+  uint8_t count;                      // samples in data
+  uint32_t interval;                  // between the last two samples, us
+  TELEM_Sample last;                  // the next delta is taken from it
+  uint32_t start;                     // time of the keyframe
+} TELEM_Block;
+
+void TELEM_InitBlock(TELEM_Block *block);
+// Adds a sample to the block, next is the time to the following sample in
+// us. Returns 1 once the block is to be sent with TELEM_EncodeBlock, before
+// the next sample.
+uint8_t TELEM_AddSample(TELEM_Block *block, const TELEM_Sample *sample,
+                        uint32_t next);
+// Writes the frame of the block, TELEM_BLOCK_FRAME_SIZE bytes at most, and
+// starts the next. Returns its length, 0 for an empty block.
+uint8_t TELEM_EncodeBlock(uint8_t *frame, TELEM_Block *block);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "main.h"
+#include "py32f0xx_ll_usart.h"
+
+// Non-blocking USART1 output. Writers copy into a ring buffer and return at
+// once, the TXE interrupt drains it a byte at a time. The main loop is the
+// only producer and the interrupt the only consumer, so each side owns one
+// index and no interrupt masking is needed. printf lands here as well.
+// Received bytes take the opposite way through a small ring of their own.
+
+// Ring buffer size in bytes, a power of two
+#ifndef UART_TX_SIZE
+#define UART_TX_SIZE 256
+#endif
+#ifndef UART_RX_SIZE
+#define UART_RX_SIZE 32
+#endif
+
+// Fastest rate: the USART divides its clock by 16 at least
+#define UART_MAX_BAUD(clock) ((clock) / 16)
+
+typedef struct UART_Stats {
+  uint32_t queued;  // bytes accepted
+  uint32_t dropped; // bytes of writes that did not fit
+  uint16_t peak;    // highest fill level of the ring buffer
+  uint32_t overrun; // received bytes lost to a full ring or the USART
+} UART_Stats;
+
+// Configures USART1 on PA2 (TX) and PA3 (RX), 8N1, and its interrupt.
+void UART_Init(uint32_t baud);
+// Queues a write as a whole or, if the buffer lacks room, drops it so that
+// records and lines are never cut. Returns len, or 0 if dropped.
+uint16_t UART_Write(const void *data, uint16_t len);
+// Takes a received byte. Returns 0 if there is none.
+uint8_t UART_Read(uint8_t *byte);
+// Returns 1 once every queued byte has left the shift register.
+uint8_t UART_Idle(void);
+// While held, writes are dropped, e.g. between a baud change acknowledge
+// and the change itself.
+void UART_Hold(uint8_t hold);
+// Rate the USART actually runs at for the requested one, 0 if out of range.
+uint32_t UART_ActualBaud(uint32_t baud);
+// Switches the rate, call when UART_Idle(). Returns the actual rate.
+uint32_t UART_SetBaud(uint32_t baud);
+const UART_Stats *UART_GetStats(void);
+// Body of USART1_IRQHandler.
+void UART_IRQHandler(void);
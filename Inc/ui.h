@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ssd1306.h"
+
+// Retained-mode text fields on top of the SSD1306 framebuffer. Each field
+// remembers the text it last rendered, so setting a new value only redraws
+// the glyphs that differ, and only those columns end up dirty. A frame with
+// no changes touches neither the framebuffer nor the bus.
+//
+// A screen is a display list of items. With SSD1306_PAGE_MODE there is no
+// framebuffer to keep the fields in: every changed frame is rendered from
+// the display list once per page and streamed page by page.
+
+// Longest text of a field, without NUL
+#ifndef UI_FIELD_LEN
+#define UI_FIELD_LEN 21
+#endif
+
+#define UI_ALIGN_LEFT 0
+#define UI_ALIGN_RIGHT 1
+
+typedef struct UI_Field {
+  const PageFontDef_t *font;
+  uint8_t x; // left edge, or the column after the right edge, see align
+  uint8_t y;
+  uint8_t align; // UI_ALIGN_*
+  uint8_t start; // column of the first rendered glyph
+  uint8_t end;   // column after the last rendered glyph
+  char text[UI_FIELD_LEN + 1];
+} UI_Field;
+
+// Draws an item completely, e.g. UI_DrawField or GRAPH_Draw
+typedef void (*UI_DrawFunc)(void *object);
+
+typedef struct UI_Item {
+  UI_DrawFunc draw;
+  void *object;
+} UI_Item;
+
+// Render cost counters, cumulative since UI_Init
+typedef struct UI_Stats {
+  uint32_t frames;   // frames queued by UI_Flush
+  uint32_t skipped;  // UI_Flush calls with nothing to send
+  uint32_t deferred; // UI_Flush calls while the previous frame was in flight
+  uint32_t glyphs;   // glyphs rendered
+  uint32_t reused;   // glyphs left in place because they did not change
+  uint32_t time;     // us spent rendering and sending
+  uint32_t bytes;    // I2C bytes of completed frames
+  uint32_t maxPoll;  // us, longest UI_Poll call, the added sampling latency
+} UI_Stats;
+
+void UI_Init(void);
+void UI_InitField(UI_Field *field, uint8_t x, uint8_t y,
+                  const PageFontDef_t *font);
+// Initializes a field whose text ends at column right - 1, for proportional
+// fonts where the width of the text varies.
+void UI_InitFieldRight(UI_Field *field, uint8_t right, uint8_t y,
+                       const PageFontDef_t *font);
+// Switches to another display list, clearing the screen and drawing all of
+// its items. The list must stay valid while it is shown.
+void UI_SetScreen(const UI_Item *items, uint8_t count);
+// Renders text into the framebuffer, redrawing only changed glyphs. Returns
+// the number of glyphs that changed.
+uint8_t UI_SetText(UI_Field *field, const char *text);
+// UI_Item draw function for a UI_Field.
+void UI_DrawField(void *field);
+// Marks the screen as changed by something else than UI_SetText, e.g. a
+// graph, for SSD1306_PAGE_MODE.
+void UI_Refresh(void);
+// Queues the dirty part of the framebuffer for sending, if any. If the
+// previous frame is still in flight the changes stay pending for the next
+// call. Returns 1 if a frame was queued.
+uint8_t UI_Flush(void);
+// Sends the next chunk of the queued frame. Call it from the idle loop
+// between samples. Returns 1 while the frame is in flight.
+uint8_t UI_Poll(void);
+const UI_Stats *UI_GetStats(void);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+// Bus-voltage transition detector. Timestamps every settled change of the
+// bus voltage level (USB PD / QC negotiation steps) together with its rise
+// time and overshoot, and keeps the most recent events in a ring buffer.
+//
+// A transition is timed between samples: from the last sample on the old
+// level to the first one inside the settle band. A departing voltage boosts
+// acquisition to fast mode (see main.c), so the end is always seen at the
+// fast rate. The resolution depends on the mode the transition starts in,
+// with the default profiles (checked by Tools/meas, meassim check):
+// - fast (2ms interval, 532us conversions): the rise time comes out up to
+//   two intervals and a conversion (4.5ms) long, a decaying overshoot needs
+//   the second interval to be seen as settled. Only the part of an overshoot
+//   that lasts longer than a conversion is seen.
+// - slow (35ms interval, 17ms averaged conversions): the start is only
+//   known to one interval. A transition shorter than that is logged with a
+//   rise time of about one interval (35..37ms), an upper bound rather than
+//   a measurement, and its overshoot is averaged away.
+
+// Number of events kept in RAM
+#ifndef VBUS_LOG_SIZE
+#define VBUS_LOG_SIZE 8
+#endif
+// Deviation from the stable level (mV) that starts a transition
+#ifndef VBUS_STEP_THRESHOLD
+#define VBUS_STEP_THRESHOLD 300
+#endif
+// Band (mV) the voltage has to stay in to count as settled
+#ifndef VBUS_SETTLE_BAND
+#define VBUS_SETTLE_BAND 100
+#endif
+// Time (us) the voltage has to stay in the band to count as settled
+#ifndef VBUS_SETTLE_TIME
+#define VBUS_SETTLE_TIME 20000
+#endif
+
+// Returned by VBUS_Update
+#define VBUS_EVENT_START 0x01  // voltage left the stable level
+#define VBUS_EVENT_LOGGED 0x02 // a new level was logged
+
+typedef struct VBUS_Event {
+  uint32_t time;      // ms since the first sample, start of the transition
+  uint32_t rise;      // us, from leaving the old level to entering the new one
+  uint16_t from;      // mV
+  uint16_t to;        // mV
+  uint16_t overshoot; // mV beyond the new level, in the direction of the step
+} VBUS_Event;
+
+typedef struct VBUS_Log {
+  VBUS_Event events[VBUS_LOG_SIZE];
+  uint8_t head;    // next slot to write
+  uint8_t count;   // valid events
+  uint8_t moving;  // a transition is in progress
+  uint8_t settled; // samples inside the settle band
+  int32_t level;   // stable level, mV << 3
+  int32_t anchor;  // first sample inside the current settle band
+  int32_t settleSum;
+  int32_t max;
+  int32_t min;
+  uint32_t start;     // us, last sample on the old level
+  uint32_t enter;     // us, first sample inside the settle band
+  uint32_t lastTime;  // us, previous sample
+  uint32_t ms;        // ms since the first sample
+  uint32_t us;        // sub-millisecond remainder of ms
+  uint8_t started;
+} VBUS_Log;
+
+void VBUS_Init(VBUS_Log *log);
+// Feeds a bus voltage sample (mV) taken at time (us). Returns VBUS_EVENT_*.
+uint8_t VBUS_Update(VBUS_Log *log, uint32_t time, int32_t voltage);
+// Returns the n-th most recent event, or NULL.
+const VBUS_Event *VBUS_GetEvent(const VBUS_Log *log, uint8_t n);
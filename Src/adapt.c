@@ -0,0 +1,105 @@
+#include "adapt.h"
+#include "ina219.h"
+#include <string.h>
+
+// Largest deviation from the mean whose square fits an int32_t, mA
+#define ADAPT_DEV_MAX 46340
+
+const ADAPT_Config ADAPT_DefaultConfig = {
+    .profiles =
+        {
+            // 2 x 17ms conversions, reports averaged over 4 samples: as
+            // quiet as AVG128, but a step is seen within the 100ms of a
+            // fixed loop, see alarm.h
+            [ADAPT_MODE_SLOW] = {INA219_CONFIG(INA219_ADC_AVG32,
+                                               INA219_ADC_AVG32),
+                                 35, 4},
+            // 2 x 532us conversions, reports averaged over 8 samples
+            [ADAPT_MODE_FAST] = {INA219_CONFIG(INA219_ADC_12BIT,
+                                               INA219_ADC_12BIT),
+                                 2, 8},
+        },
+    .delta = 50,
+    .variance = 400,
+    .holdoff = 500,
+};
+
+void ADAPT_Init(ADAPT_Controller *ctl, const ADAPT_Config *config) {
+  memset(ctl, 0, sizeof(*ctl));
+  ctl->config = config;
+  ctl->mode = ADAPT_MODE_SLOW;
+}
+
+uint8_t ADAPT_Update(ADAPT_Controller *ctl, int16_t shunt, int16_t bus,
+                     int32_t current) {
+  const ADAPT_Config *config = ctl->config;
+  uint8_t events = 0;
+
+  int32_t delta = current - ctl->last;
+  if (delta < 0) {
+    delta = -delta;
+  }
+  ctl->last = current;
+  // Exponentially weighted mean and variance, 1/8 per sample
+  ctl->mean += (current * 16 - ctl->mean) >> 3;
+  int32_t dev = current - (ctl->mean >> 4);
+  // Far beyond any threshold, the clamp only keeps the square in 32 bits
+  if (dev > ADAPT_DEV_MAX) {
+    dev = ADAPT_DEV_MAX;
+  } else if (dev < -ADAPT_DEV_MAX) {
+    dev = -ADAPT_DEV_MAX;
+  }
+  ctl->var += (dev * dev - ctl->var) >> 3;
+
+  if (delta > config->delta || ctl->var > config->variance) {
+    ctl->quiet = 0;
+    if (ctl->mode != ADAPT_MODE_FAST) {
+      ctl->mode = ADAPT_MODE_FAST;
+      events |= ADAPT_EVENT_MODE;
+    }
+  } else if (ctl->mode == ADAPT_MODE_FAST &&
+             delta <= config->delta / 2 && ctl->var <= config->variance / 2) {
+    // Hysteresis: only quiet samples well below the thresholds count
+    if (++ctl->quiet >= config->holdoff) {
+      ctl->quiet = 0;
+      ctl->mode = ADAPT_MODE_SLOW;
+      events |= ADAPT_EVENT_MODE;
+    }
+  }
+  if (events & ADAPT_EVENT_MODE) {
+    ctl->switches++;
+    // Restart the report so it never mixes samples from both modes
+    ctl->count = 0;
+    ctl->shuntSum = 0;
+    ctl->busSum = 0;
+  }
+
+  ctl->shuntSum += shunt;
+  ctl->busSum += bus;
+  if (++ctl->count >= config->profiles[ctl->mode].decimate) {
+    ctl->shunt = ctl->shuntSum / ctl->count;
+    ctl->bus = ctl->busSum / ctl->count;
+    ctl->count = 0;
+    ctl->shuntSum = 0;
+    ctl->busSum = 0;
+    events |= ADAPT_EVENT_REPORT;
+  }
+  return events;
+}
+
+uint8_t ADAPT_Boost(ADAPT_Controller *ctl) {
+  ctl->quiet = 0;
+  if (ctl->mode == ADAPT_MODE_FAST) {
+    return 0;
+  }
+  ctl->mode = ADAPT_MODE_FAST;
+  ctl->switches++;
+  ctl->count = 0;
+  ctl->shuntSum = 0;
+  ctl->busSum = 0;
+  return ADAPT_EVENT_MODE;
+}
+
+const ADAPT_Profile *ADAPT_GetProfile(const ADAPT_Controller *ctl) {
+  return &ctl->config->profiles[ctl->mode];
+}
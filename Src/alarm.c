@@ -0,0 +1,80 @@
+#include "alarm.h"
+#include <string.h>
+
+static void ALARM_SetOutput(uint8_t active) {
+#ifdef ALARM_GPIO_PORT
+#ifdef ALARM_GPIO_ACTIVE_LOW
+  active = !active;
+#endif
+  ALARM_GPIO_PORT->BSRR = active ? ALARM_GPIO_PIN : (ALARM_GPIO_PIN << 16);
+#else
+  (void)active;
+#endif
+}
+
+void ALARM_Init(ALARM_Monitor *mon, int32_t shuntLimit, int32_t powerLimit) {
+  memset(mon, 0, sizeof(*mon));
+  mon->shuntLimit = shuntLimit;
+  mon->powerLimit = powerLimit;
+#ifdef ALARM_GPIO_PORT
+  LL_GPIO_InitTypeDef GPIO_InitStruct = {
+      .Pin = ALARM_GPIO_PIN,
+      .Mode = LL_GPIO_MODE_OUTPUT,
+      .OutputType = LL_GPIO_OUTPUT_PUSHPULL,
+      .Pull = LL_GPIO_NOPULL,
+      .Speed = LL_GPIO_SPEED_FREQ_HIGH,
+  };
+  ALARM_SetOutput(0);
+  LL_GPIO_Init(ALARM_GPIO_PORT, &GPIO_InitStruct);
+#endif
+}
+
+static uint8_t ALARM_Trip(ALARM_Monitor *mon, uint8_t cause) {
+  uint8_t events = mon->cause ? 0 : ALARM_EVENT_TRIP;
+  if (events) {
+    ALARM_SetOutput(1);
+    mon->trips++;
+  }
+  mon->cause |= cause;
+  return events;
+}
+
+uint8_t ALARM_CheckShunt(ALARM_Monitor *mon, int16_t shunt, uint32_t time) {
+  if (mon->checked && time - mon->lastCheck > mon->maxGap) {
+    mon->maxGap = time - mon->lastCheck;
+  }
+  mon->lastCheck = time;
+  mon->checked = 1;
+
+  int32_t value = shunt < 0 ? -shunt : shunt;
+  if (mon->shuntLimit && value > mon->shuntLimit) {
+    return ALARM_Trip(mon, ALARM_CAUSE_CURRENT);
+  }
+  if (mon->shuntLimit && value > mon->shuntLimit - (mon->shuntLimit >> 2)) {
+    return ALARM_EVENT_NEAR;
+  }
+  return 0;
+}
+
+uint8_t ALARM_CheckPower(ALARM_Monitor *mon, int16_t shunt, int16_t bus) {
+  int32_t current = shunt < 0 ? -shunt : shunt;
+  int32_t power = current * bus;
+  if (mon->powerLimit && power > mon->powerLimit) {
+    return ALARM_Trip(mon, ALARM_CAUSE_POWER);
+  }
+  if (!mon->cause) {
+    uint8_t near =
+        mon->powerLimit && power > mon->powerLimit - (mon->powerLimit >> 2);
+    return near ? ALARM_EVENT_NEAR : 0;
+  }
+  uint8_t currentOk = !mon->shuntLimit ||
+                      current <= mon->shuntLimit - (mon->shuntLimit >> 3);
+  uint8_t powerOk = !mon->powerLimit ||
+                    power <= mon->powerLimit - (mon->powerLimit >> 3);
+  if (currentOk && powerOk) {
+    mon->cause = 0;
+    ALARM_SetOutput(0);
+    return ALARM_EVENT_CLEAR;
+  }
+  return 0;
+}
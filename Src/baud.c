@@ -0,0 +1,108 @@
+#include "baud.h"
+#include "fmt.h"
+
+#include <string.h>
+
+void BAUD_Init(BAUD_Link *link, uint32_t rate,
+               uint16_t (*write)(const void *data, uint16_t len)) {
+  memset(link, 0, sizeof(*link));
+  link->rate = rate;
+  link->previous = rate;
+  link->write = write;
+}
+
+int32_t BAUD_Error(uint32_t requested, uint32_t actual) {
+  // Rounding the divider (at least 16) is off by 1/32 at most, so the
+  // difference times 10000 fits in 32 bits below clock / 16
+  int32_t diff = (int32_t)(actual - requested);
+  return diff * 10000 / (int32_t)requested;
+}
+
+// Sends "baud <word><rate>[ actual <actual> error <error>%]" as one write,
+// the second part only if actual is not 0. Returns 0 if the output buffer
+// had no room for it.
+static uint16_t BAUD_Reply(BAUD_Link *link, const char *word, uint32_t rate,
+                           uint32_t actual) {
+  char reply[BAUD_REPLY_LEN];
+  char *p = reply;
+  memcpy(p, "baud ", 5);
+  p += 5;
+  while (*word) {
+    *p++ = *word++;
+  }
+  p = FMT_Fixed(p, rate, 0, 0, 0, "");
+  if (actual) {
+    memcpy(p, " actual ", 8);
+    p = FMT_Fixed(p + 8, actual, 0, 0, 0, " error ");
+    p = FMT_Fixed(p, BAUD_Error(rate, actual), 2, 2, 0, "%");
+  }
+  *p++ = '\n';
+  return link->write(reply, p - reply);
+}
+
+// Parses a decimal rate, 0 if the text is not one
+static uint32_t BAUD_ParseRate(const char *text) {
+  uint32_t rate = 0;
+  for (; *text >= '0' && *text <= '9'; text++) {
+    if (rate > UART_MAX_BAUD(SystemCoreClock)) {
+      return 0;
+    }
+    rate = rate * 10 + (*text - '0');
+  }
+  return *text == '\0' ? rate : 0;
+}
+
+void BAUD_Command(BAUD_Link *link, const char *arg) {
+  if (link->state == BAUD_STATE_CONFIRM) {
+    // The host made it to the new rate
+    if (strcmp(arg, "ok") == 0) {
+      link->state = BAUD_STATE_IDLE;
+      link->previous = link->rate;
+      link->switches++;
+      UART_Hold(0);
+      BAUD_Reply(link, "ok ", link->rate, 0);
+    }
+    return;
+  }
+  if (link->state != BAUD_STATE_IDLE) {
+    return;
+  }
+  if (*arg == '\0') {
+    BAUD_Reply(link, "", link->rate, UART_ActualBaud(link->rate));
+    return;
+  }
+
+  uint32_t requested = BAUD_ParseRate(arg);
+  uint32_t actual = UART_ActualBaud(requested);
+  int32_t error = actual ? BAUD_Error(requested, actual) : 0;
+  if (actual == 0 || error > BAUD_MAX_ERROR || error < -BAUD_MAX_ERROR) {
+    BAUD_Reply(link, "refused ", requested, actual);
+    return;
+  }
+  // Answer at the old rate; nothing may follow it until the switch. If the
+  // answer does not fit, the host times out and asks again.
+  if (!BAUD_Reply(link, "", requested, actual)) {
+    return;
+  }
+  UART_Hold(1);
+  link->previous = link->rate;
+  link->rate = requested;
+  link->state = BAUD_STATE_ACK;
+}
+
+void BAUD_Poll(BAUD_Link *link, uint32_t now) {
+  if (link->state == BAUD_STATE_ACK && UART_Idle()) {
+    UART_SetBaud(link->rate);
+    link->since = now;
+    link->state = BAUD_STATE_CONFIRM;
+  } else if (link->state == BAUD_STATE_CONFIRM &&
+             now - link->since >= BAUD_CONFIRM_TIME) {
+    // The host did not follow, go back to where it still listens
+    UART_SetBaud(link->previous);
+    link->rate = link->previous;
+    link->state = BAUD_STATE_IDLE;
+    link->fallbacks++;
+    UART_Hold(0);
+    BAUD_Reply(link, "fallback ", link->rate, 0);
+  }
+}
@@ -0,0 +1,103 @@
+#include "filter.h"
+#include "main.h"
+#include <string.h>
+
+// Butterworth low-pass, fc = fs / 20, sign convention of CMSIS-DSP:
+//   y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+// a1 > 1, so both coefficient sets are scaled by 1/2 (postShift = 1).
+#define FILTER_POST_SHIFT 1
+// b0, b1, b2, a1, a2 in Q14
+static const int16_t FILTER_Coeffs16[5] = {329, 658, 329, 25576, -10508};
+#ifdef USE_DSP
+// b0, b1, b2, a1, a2 in Q30
+static const q31_t FILTER_Coeffs31[5] = {21564350, 43128699, 21564350,
+                                         1676130396, -688645970};
+#endif
+
+// Samples per benchmark run, small enough to finish within one SysTick period
+#define FILTER_BENCH_SAMPLES 16
+
+// The poles sit close to z = 1, so plain truncation of a 16-bit output would
+// amplify into a DC error of up to 12 LSB. Feeding the truncated fraction
+// back into the next sample removes it.
+static int16_t FILTER_Integer(FILTER_State *filter, int16_t sample) {
+  int16_t *state = filter->state;
+  int32_t acc = filter->error + (int32_t)FILTER_Coeffs16[0] * sample +
+                (int32_t)FILTER_Coeffs16[1] * state[0] +
+                (int32_t)FILTER_Coeffs16[2] * state[1] +
+                (int32_t)FILTER_Coeffs16[3] * state[2] +
+                (int32_t)FILTER_Coeffs16[4] * state[3];
+  int32_t out = acc >> (15 - FILTER_POST_SHIFT);
+  filter->error = acc - out * (1 << (15 - FILTER_POST_SHIFT));
+  if (out > INT16_MAX) {
+    out = INT16_MAX;
+  } else if (out < INT16_MIN) {
+    out = INT16_MIN;
+  }
+  state[1] = state[0];
+  state[0] = sample;
+  state[3] = state[2];
+  state[2] = (int16_t)out;
+  return (int16_t)out;
+}
+
+void FILTER_Init(FILTER_State *filter) {
+  memset(filter, 0, sizeof(*filter));
+#ifdef USE_DSP
+  arm_biquad_cascade_df1_init_q31(&filter->instance, 1,
+                                  (q31_t *)FILTER_Coeffs31, filter->dspState,
+                                  FILTER_POST_SHIFT);
+#endif
+}
+
+void FILTER_Reset(FILTER_State *filter, int16_t value) {
+  for (uint8_t i = 0; i < 4; i++) {
+    filter->state[i] = value;
+#ifdef USE_DSP
+    filter->dspState[i] = (q31_t)value * 65536;
+#endif
+  }
+  filter->error = 0;
+}
+
+int16_t FILTER_Update(FILTER_State *filter, int16_t sample) {
+#ifdef USE_DSP
+  // Samples go in as the upper half of a q31, the lower half keeps the
+  // fractional precision of the feedback path. Multiplied rather than
+  // shifted, a left shift of a negative sample is undefined.
+  q31_t in = (q31_t)sample * 65536;
+  q31_t out;
+  arm_biquad_cascade_df1_q31(&filter->instance, &in, &out, 1);
+  return (int16_t)((out + 0x8000) >> 16);
+#else
+  return FILTER_Integer(filter, sample);
+#endif
+}
+
+static uint32_t FILTER_Elapsed(uint32_t start) {
+  // SysTick counts down and reloads every millisecond
+  uint32_t end = SysTick->VAL;
+  return start >= end ? start - end : start + SysTick->LOAD + 1 - end;
+}
+
+uint32_t FILTER_Benchmark(uint32_t *integer) {
+  FILTER_State filter;
+  volatile int16_t sink;
+  uint32_t start;
+
+  FILTER_Init(&filter);
+  if (integer != NULL) {
+    start = SysTick->VAL;
+    for (uint8_t i = 0; i < FILTER_BENCH_SAMPLES; i++) {
+      sink = FILTER_Integer(&filter, i << 10);
+    }
+    *integer = FILTER_Elapsed(start) / FILTER_BENCH_SAMPLES;
+  }
+
+  start = SysTick->VAL;
+  for (uint8_t i = 0; i < FILTER_BENCH_SAMPLES; i++) {
+    sink = FILTER_Update(&filter, i << 10);
+  }
+  (void)sink;
+  return FILTER_Elapsed(start) / FILTER_BENCH_SAMPLES;
+}
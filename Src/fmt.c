@@ -0,0 +1,70 @@
+#include "fmt.h"
+
+static const uint32_t FMT_Pow10[] = {
+    1,      10,      100,      1000,      10000,
+    100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+char *FMT_Fixed(char *buf, int32_t value, uint8_t scale, uint8_t decimals,
+                uint8_t width, const char *unit) {
+  char tmp[24];
+  char *p = tmp;
+  uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+
+  if (decimals > scale) {
+    decimals = scale;
+  }
+  if (scale > decimals) {
+    uint32_t div = FMT_Pow10[scale - decimals];
+    magnitude = magnitude / div + (magnitude % div >= div / 2);
+  }
+  if (value < 0 && magnitude != 0) {
+    *p++ = '-';
+  }
+
+  // Digits by repeated subtraction, the M0+ has no divider
+  int8_t digit = 9;
+  while (digit > decimals && magnitude < FMT_Pow10[digit]) {
+    digit--;
+  }
+  for (; digit >= 0; digit--) {
+    char c = '0';
+    while (magnitude >= FMT_Pow10[digit]) {
+      magnitude -= FMT_Pow10[digit];
+      c++;
+    }
+    *p++ = c;
+    if (digit == decimals && decimals > 0) {
+      *p++ = '.';
+    }
+  }
+  while (*unit) {
+    *p++ = *unit++;
+  }
+
+  uint8_t len = p - tmp;
+  for (; width > len; width--) {
+    *buf++ = ' ';
+  }
+  for (uint8_t i = 0; i < len; i++) {
+    *buf++ = tmp[i];
+  }
+  *buf = '\0';
+  return buf;
+}
+
+char *FMT_Auto(char *buf, int32_t milli, uint8_t width, const char *unit) {
+  char prefixed[8] = {'m'};
+  uint32_t magnitude = milli < 0 ? -(uint32_t)milli : (uint32_t)milli;
+
+  if (magnitude < 1000) {
+    for (uint8_t i = 0; unit[i] && i < sizeof(prefixed) - 2; i++) {
+      prefixed[i + 1] = unit[i];
+    }
+    return FMT_Fixed(buf, milli, 0, 0, width, prefixed);
+  }
+  // Three decimals are exact, two round and can carry into the next decade,
+  // e.g. 99995 -> "100.0"
+  uint8_t decimals = magnitude < 10000 ? 3 : magnitude < 99995 ? 2 : 1;
+  return FMT_Fixed(buf, milli, 3, decimals, width, unit);
+}
@@ -0,0 +1,176 @@
+#include "graph.h"
+
+#define GRAPH_MASK                                                             \
+  (GRAPH_HEIGHT >= 32 ? 0xFFFFFFFFUL : (1UL << GRAPH_HEIGHT) - 1)
+
+void GRAPH_Init(GRAPH_Trend *graph) {
+  memset(graph, 0, sizeof(*graph));
+  graph->redraw = 1;
+}
+
+void GRAPH_Add(GRAPH_Trend *graph, int32_t value) {
+  if (value > INT16_MAX) {
+    value = INT16_MAX;
+  } else if (value < INT16_MIN) {
+    value = INT16_MIN;
+  }
+  if (!graph->open) {
+    graph->colMin = graph->colMax = value;
+    graph->open = 1;
+  } else if (value < graph->colMin) {
+    graph->colMin = value;
+  } else if (value > graph->colMax) {
+    graph->colMax = value;
+  }
+}
+
+// Fits the axis around the data with 1/8 of the span as margin
+static void GRAPH_Rescale(GRAPH_Trend *graph) {
+  int32_t span = graph->dataMax - graph->dataMin;
+  if (span < GRAPH_MIN_SPAN) {
+    span = GRAPH_MIN_SPAN;
+  }
+  int32_t mid = (graph->dataMax + graph->dataMin) / 2;
+  int32_t half = span / 2 + span / 8;
+  int32_t lo = mid - half;
+  int32_t hi = mid + half;
+  graph->lo = lo < INT16_MIN ? INT16_MIN : lo;
+  graph->hi = hi > INT16_MAX ? INT16_MAX : hi;
+  graph->redraw = 1;
+}
+
+void GRAPH_Push(GRAPH_Trend *graph) {
+  if (!graph->open) {
+    return;
+  }
+  graph->open = 0;
+
+  uint8_t slot = graph->head;
+  uint8_t evicted = graph->count == GRAPH_WIDTH &&
+                    (graph->min[slot] <= graph->dataMin ||
+                     graph->max[slot] >= graph->dataMax);
+  graph->min[slot] = graph->colMin;
+  graph->max[slot] = graph->colMax;
+  graph->head = slot + 1 == GRAPH_WIDTH ? 0 : slot + 1;
+  if (graph->count < GRAPH_WIDTH) {
+    graph->count++;
+  }
+  if (graph->stale < GRAPH_WIDTH) {
+    graph->stale++;
+  }
+
+  if (graph->count == 1) {
+    graph->dataMin = graph->colMin;
+    graph->dataMax = graph->colMax;
+    GRAPH_Rescale(graph);
+    return;
+  }
+  if (evicted) {
+    // The column holding an extreme left the ring, the only case that needs
+    // a scan
+    graph->dataMin = graph->dataMax = graph->colMin;
+    for (uint8_t i = 0; i < graph->count; i++) {
+      if (graph->min[i] < graph->dataMin) {
+        graph->dataMin = graph->min[i];
+      }
+      if (graph->max[i] > graph->dataMax) {
+        graph->dataMax = graph->max[i];
+      }
+    }
+  } else {
+    if (graph->colMin < graph->dataMin) {
+      graph->dataMin = graph->colMin;
+    }
+    if (graph->colMax > graph->dataMax) {
+      graph->dataMax = graph->colMax;
+    }
+  }
+
+  // Grow as soon as the data leaves the axis, shrink only once it uses less
+  // than half of it, so the scale does not change on every column
+  int32_t span = graph->dataMax - graph->dataMin;
+  if (graph->dataMin < graph->lo || graph->dataMax > graph->hi ||
+      (span * 2 < graph->hi - graph->lo &&
+       graph->hi - graph->lo > GRAPH_MIN_SPAN * 5 / 4)) {
+    GRAPH_Rescale(graph);
+  }
+}
+
+static void GRAPH_DrawColumn(const GRAPH_Trend *graph, uint8_t x,
+                             int8_t slot) {
+  uint32_t bits = 0;
+  if (slot >= 0) {
+    int32_t range = graph->hi - graph->lo;
+    // Row 0 is the top of the panel
+    uint8_t top = (GRAPH_HEIGHT - 1) - (int32_t)(graph->max[slot] - graph->lo) *
+                                           (GRAPH_HEIGHT - 1) / range;
+    uint8_t bottom =
+        (GRAPH_HEIGHT - 1) -
+        (int32_t)(graph->min[slot] - graph->lo) * (GRAPH_HEIGHT - 1) / range;
+    bits = (0xFFFFFFFFUL >> (31 - bottom)) & ~((1UL << top) - 1);
+  }
+  SSD1306_DrawColumn(x, 0, bits, GRAPH_MASK);
+}
+
+void GRAPH_Draw(void *object) {
+  GRAPH_Trend *graph = object;
+#ifdef GRAPH_SWEEP
+  for (uint8_t slot = 0; slot < GRAPH_WIDTH; slot++) {
+    GRAPH_DrawColumn(graph, GRAPH_X + slot, slot < graph->count ? slot : -1);
+  }
+  GRAPH_DrawColumn(graph, GRAPH_X + graph->head, -1);
+#else
+  uint8_t slot = graph->head;
+  for (uint8_t x = SSD1306_WIDTH, n = 0; n < GRAPH_WIDTH; n++) {
+    slot = slot == 0 ? GRAPH_WIDTH - 1 : slot - 1;
+    GRAPH_DrawColumn(graph, --x, n < graph->count ? (int8_t)slot : -1);
+  }
+#endif
+  graph->stale = 0;
+  graph->redraw = 0;
+}
+
+uint8_t GRAPH_Render(GRAPH_Trend *graph) {
+  uint8_t drawn = 0;
+
+#if defined(SSD1306_PAGE_MODE)
+  // Nothing is kept between frames, GRAPH_Draw renders the whole graph
+  // from the display list
+  drawn = graph->redraw ? GRAPH_WIDTH : graph->stale;
+#elif defined(GRAPH_SWEEP)
+  // Slot i is always drawn at column i, the gap marks the next slot
+  if (graph->redraw) {
+    GRAPH_Draw(graph);
+    drawn = GRAPH_WIDTH;
+  } else {
+    uint8_t slot = graph->head;
+    for (drawn = 0; drawn < graph->stale; drawn++) {
+      slot = slot == 0 ? GRAPH_WIDTH - 1 : slot - 1;
+      GRAPH_DrawColumn(graph, GRAPH_X + slot, slot);
+    }
+    if (drawn) {
+      GRAPH_DrawColumn(graph, GRAPH_X + graph->head, -1);
+    }
+  }
+#else
+  // The newest column is always at the right edge
+  uint8_t n = graph->redraw ? GRAPH_WIDTH : graph->stale;
+  if (n == 0) {
+    return 0;
+  }
+  if (n == GRAPH_WIDTH) {
+    GRAPH_Draw(graph);
+    return n;
+  }
+  SSD1306_ScrollLeft(GRAPH_X, SSD1306_WIDTH - 1, 0, GRAPH_HEIGHT / 8 - 1, n);
+  uint8_t slot = graph->head;
+  for (uint8_t x = SSD1306_WIDTH; drawn < n; drawn++) {
+    slot = slot == 0 ? GRAPH_WIDTH - 1 : slot - 1;
+    GRAPH_DrawColumn(graph, --x, drawn < graph->count ? (int8_t)slot : -1);
+  }
+#endif
+
+  graph->stale = 0;
+  graph->redraw = 0;
+  return drawn;
+}
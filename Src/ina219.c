@@ -5,10 +5,14 @@ static SWIIC_Config* ina219_swiic;
 
 void INA219_Init(SWIIC_Config *swiic) {
   ina219_swiic = swiic;
-  uint8_t config[] = {0x36, 0xEF};
-  SWIIC_State ok = SWIIC_WriteBytes8(ina219_swiic, INA219_ADDR, INA219_REG_CONF, config, 2);
+  INA219_SetConfig(INA219_CONFIG(INA219_ADC_AVG32, INA219_ADC_AVG32));
+}
+
+void INA219_SetConfig(uint16_t config) {
+  uint8_t data[] = {config >> 8, config & 0xFF};
+  SWIIC_State ok = SWIIC_WriteBytes8(ina219_swiic, INA219_ADDR, INA219_REG_CONF, data, 2);
   if (ok != SWIIC_OK) {
-    printf("INA219_Init failed\n");
+    printf("INA219_SetConfig failed\n");
   }
 }
 
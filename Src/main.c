@@ -8,36 +8,231 @@
 
 #include "main.h"
 #include "py32f0xx_bsp_clock.h"
-#include "py32f0xx_bsp_printf.h"
 
 #include "swiic.h"
 #include "ssd1306.h"
 #include "ina219.h"
+#include "page_fonts.h"
+#include "period.h"
+#include "adapt.h"
+#include "vbus.h"
+#include "alarm.h"
+#include "filter.h"
+#include "fmt.h"
+#include "ui.h"
+#include "graph.h"
+#include "seg7.h"
+#include "telem.h"
+#include "uart.h"
+#include "baud.h"
+#include "shell.h"
 
-static void APP_PrintInt(int num);
-static void APP_PrintString(char *str);
+static void APP_PrintString(const char *str);
+static void APP_PrintText(const char *text, const char *end);
 static void APP_SPrintInt(char *str, int num);
 static void APP_EnsureOptionBytes(void);
 static void APP_GPIOConfig(void);
 static void APP_FlashSetOptionBytes(void);
 static void APP_SSD1306Demo(void);
+static void APP_DrawMain(int current, int busVoltage, int power, int energy);
+static void APP_DrawEvents(void);
+static void APP_DrawGraph(int current);
+static void APP_DrawBig(int current, int busVoltage);
+static void APP_DumpEvents(void);
+static void APP_WaitForDevice(uint8_t addr, uint32_t timeout);
+static void APP_PrintBoot(void);
+static void APP_Write(const uint8_t *data, uint16_t len);
+static void APP_PollSerial(void);
+static void APP_InitAlarm(void);
+static void APP_ApplySettings(void);
+static void APP_SettingChanged(const SHELL_Var *var);
+static uint16_t APP_ShellWrite(const void *data, uint16_t len);
+static void APP_FlushBlock(void);
+static uint8_t APP_Stream(uint8_t argc, char **argv, uint8_t index,
+                          char *reply);
+static uint8_t APP_Stats(uint8_t argc, char **argv, uint8_t index,
+                         char *reply);
+static uint8_t APP_Events(uint8_t argc, char **argv, uint8_t index,
+                          char *reply);
+static uint8_t APP_Baud(uint8_t argc, char **argv, uint8_t index,
+                        char *reply);
 
 SWIIC_Config swiic_config;
+PERIOD_Detector period_detector;
+ADAPT_Controller adapt;
+VBUS_Log vbus_log;
+ALARM_Monitor alarm;
+FILTER_State shunt_filter;
+UI_Field main_fields[4];
+UI_Field event_fields[SSD1306_HEIGHT / 8];
+UI_Field graph_fields[3];
+GRAPH_Trend current_graph;
+BAUD_Link serial_link;
+SHELL_State serial_shell;
+TELEM_Block sample_block;
+SEG7_Field big_current;
+UI_Field big_fields[2];
 
-// >>> CHANGE THIS VALUE TO MATCH YOUR HARDWARE
-// 2mR shunt resistor -> 5000 / 10000
-// 10mR shunt resistor -> 1000 / 10000
+static const UI_Item main_screen[] = {
+    {UI_DrawField, &main_fields[0]},
+    {UI_DrawField, &main_fields[1]},
+    {UI_DrawField, &main_fields[2]},
+    {UI_DrawField, &main_fields[3]},
+};
+static const UI_Item event_screen[] = {
+    {UI_DrawField, &event_fields[0]},
+    {UI_DrawField, &event_fields[1]},
+    {UI_DrawField, &event_fields[2]},
+    {UI_DrawField, &event_fields[3]},
+};
+static const UI_Item graph_screen[] = {
+    {GRAPH_Draw, &current_graph},
+    {UI_DrawField, &graph_fields[0]},
+    {UI_DrawField, &graph_fields[1]},
+    {UI_DrawField, &graph_fields[2]},
+};
+static const UI_Item big_screen[] = {
+    {SEG7_DrawField, &big_current},
+    {UI_DrawField, &big_fields[0]},
+    {UI_DrawField, &big_fields[1]},
+};
+volatile uint32_t APP_TickMs;
+
+// Boot timeline in us since SysTick start
+static struct {
+  uint32_t display; // panel initialized
+  uint32_t sensor;  // INA219 configured
+  uint32_t sample;  // first sample read
+  uint32_t report;  // first report printed
+  uint32_t frame;   // first frame on the panel
+} APP_Boot;
+
+// >>> CHANGE THIS VALUE TO MATCH YOUR HARDWARE, or "set shunt_lsb" at run time
+// Current of one shunt register LSB (10uV) in uA
+// 2mR shunt resistor -> 5000
+// 10mR shunt resistor -> 1000
 // PCB layout may affect the calibration value,
 // it's better to measure the current and adjust the value.
-#define CURRENT_CALIBRATION 5000 / 10000
+#define APP_SHUNT_LSB 5000
+
+// Over-current / over-power alarm thresholds, 0 disables
+#define ALARM_CURRENT_LIMIT 5500 // mA
+#define ALARM_POWER_LIMIT 105000 // mW
+
+// Default slow profile, sample interval in ms and index into APP_AdcModes.
+// With an alarm limit it reacts within 100ms (see alarm.h), without one it
+// can average longer.
+#if ALARM_CURRENT_LIMIT || ALARM_POWER_LIMIT
+#define APP_SLOW_MS 35
+#define APP_SLOW_ADC 3 // avg32
+#else
+#define APP_SLOW_MS 140
+#define APP_SLOW_ADC 4 // avg128
+#endif
+// Slow mode reports about this often (ms), whatever its sample interval
+#define APP_SLOW_REPORT_MS 140
+
+// Longest line through the shell write hook, a shell or a baud reply
+#if SHELL_REPLY_LEN + 2 > BAUD_REPLY_LEN
+#define APP_LINE_LEN (SHELL_REPLY_LEN + 2)
+#else
+#define APP_LINE_LEN BAUD_REPLY_LEN
+#endif
+
+// Longest message of the text output, a report or a line, NUL included
+#define APP_TEXT_LEN 160
+
+// Display refresh interval in ms, independent of the sample rate
+#define APP_FRAME_INTERVAL 100
+// Time in ms the event page stays on screen after a new bus voltage event
+#define APP_EVENT_PAGE_TIME 3000
+
+// Time in ms the main page and the trend graph each stay on screen
+#define APP_PAGE_TIME 5000
+
+// Longest time in ms to wait for a chip to answer after power-up
+#define APP_BOOT_TIMEOUT 100
+
+// Serial rate at reset, the host can negotiate a faster one, see baud.h
+#define APP_BAUD 115200
+
+// Serial output: text reports, a binary record of every sample, or the
+// samples in delta blocks of about a quarter the size, see telem.h
+#define APP_OUTPUT_TEXT 0
+#define APP_OUTPUT_BINARY 1
+#define APP_OUTPUT_DELTA 2
+
+#if defined(APP_SERIAL_DELTA)
+#define APP_OUTPUT APP_OUTPUT_DELTA
+#elif defined(APP_SERIAL_BINARY)
+#define APP_OUTPUT APP_OUTPUT_BINARY
+#else
+#define APP_OUTPUT APP_OUTPUT_TEXT
+#endif
+
+// INA219 averaging selectable for each mode, and the time in ms the bus and
+// the shunt conversion take together with it, rounded up
+static const uint8_t APP_AdcModes[] = {INA219_ADC_12BIT, INA219_ADC_AVG2,
+                                       INA219_ADC_AVG8, INA219_ADC_AVG32,
+                                       INA219_ADC_AVG128};
+static const uint8_t APP_AdcTime[] = {2, 3, 9, 35, 137};
+static const char *const APP_AdcNames[] = {"12bit", "avg2", "avg8", "avg32",
+                                           "avg128"};
+static const char *const APP_OutputNames[] = {"text", "binary", "delta"};
+
+// Settings the serial shell can change, see shell.h
+static struct {
+  int32_t output;   // APP_OUTPUT_*
+  int32_t shuntLsb; // uA per shunt register LSB
+  int32_t fastMs;   // sample intervals, at least the conversion time
+  int32_t slowMs;
+  int32_t fastAdc;  // index into APP_AdcModes
+  int32_t slowAdc;
+} APP_Settings = {APP_OUTPUT, APP_SHUNT_LSB, 2, APP_SLOW_MS, 0, APP_SLOW_ADC};
+
+// Reports and records are sent while streaming, replies always
+static uint8_t APP_Streaming = 1;
+
+// Built from ADAPT_DefaultConfig and the settings
+static ADAPT_Config APP_AdaptConfig;
+
+static const SHELL_Var APP_Vars[] = {
+    {"output", &APP_Settings.output, 0, 2, APP_OutputNames},
+    // 500mR to 0.2mR shunts: the raw power limit and a full-scale sample
+    // times the LSB still fit in 32 bits
+    {"shunt_lsb", &APP_Settings.shuntLsb, 20, 50000, NULL},
+    {"fast_ms", &APP_Settings.fastMs, 1, 1000, NULL},
+    {"slow_ms", &APP_Settings.slowMs, 1, 10000, NULL},
+    {"fast_adc", &APP_Settings.fastAdc, 0, 4, APP_AdcNames},
+    {"slow_adc", &APP_Settings.slowAdc, 0, 4, APP_AdcNames},
+};
+static const SHELL_Command APP_Commands[] = {
+    {"stream", "start|stop", APP_Stream},
+    {"stats", "", APP_Stats},
+    {"events", "", APP_Events},
+    {"baud", "[rate|ok]", APP_Baud},
+};
+static const SHELL_Config APP_ShellConfig = {
+    APP_Commands, sizeof(APP_Commands) / sizeof(APP_Commands[0]),
+    APP_Vars,     sizeof(APP_Vars) / sizeof(APP_Vars[0]),
+    APP_SettingChanged, APP_ShellWrite,
+};
+
+#define APP_PAGE_MAIN 0
+#define APP_PAGE_EVENTS 1
+#define APP_PAGE_GRAPH 2
+#define APP_PAGE_BIG 3
 
 int main(void) {
   BSP_RCC_HSI_24MConfig();
-  LL_mDelay(1000);
+  LL_SYSTICK_EnableIT();
   APP_EnsureOptionBytes();
   /* Don't config GPIO before changing the option bytes */
   APP_GPIOConfig();
-  BSP_USART_Config(115200);
+  UART_Init(APP_BAUD);
+  BAUD_Init(&serial_link, APP_BAUD, APP_ShellWrite);
+  SHELL_Init(&serial_shell, &APP_ShellConfig);
+  TELEM_InitBlock(&sample_block);
 
   swiic_config.SDA_Port = GPIOA;
   swiic_config.SDA_Pin = LL_GPIO_PIN_4;
@@ -46,72 +241,517 @@ int main(void) {
   swiic_config.delay = 10;
   SWIIC_Init(&swiic_config);
 
+  // The panel and the sensor power up with the board, wait until the panel
+  // answers instead of a fixed delay
+  APP_WaitForDevice(SSD1306_I2C_ADDR, APP_BOOT_TIMEOUT);
   SSD1306_Init();
-  INA219_Init(&swiic_config);  
+  APP_Boot.display = APP_GetMicros();
+  INA219_Init(&swiic_config);
+  PERIOD_Init(&period_detector);
+  VBUS_Init(&vbus_log);
+  APP_InitAlarm();
+
+  FILTER_Init(&shunt_filter);
 
+  UI_Init();
+  // Current, voltage and energy on the left, power right-aligned. The fonts
+  // are proportional with tabular digits, see page_fonts in CMakeLists.txt.
+  // Power and the first line sit on page boundaries, where glyphs are copied
+  // as bytes; three 10-row lines cannot all fit on them.
+  UI_InitField(&main_fields[0], 0, 0, &PageFont_6x10);
+  UI_InitField(&main_fields[1], 0, 11, &PageFont_6x10);
+  UI_InitField(&main_fields[2], 0, 22, &PageFont_6x10);
+  UI_InitFieldRight(&main_fields[3], SSD1306_WIDTH, 8, &PageFont_11x18);
+  for (uint8_t i = 0; i < SSD1306_HEIGHT / 8; i++) {
+    UI_InitField(&event_fields[i], 0, i * 8, &PageFont_6x8);
+  }
+  // Axis limits on top and bottom, the last report in between
+  UI_InitField(&graph_fields[0], 0, 0, &PageFont_6x8);
+  UI_InitField(&graph_fields[1], 0, 12, &PageFont_6x8);
+  UI_InitField(&graph_fields[2], 0, 24, &PageFont_6x8);
+  // Current in full-height digits, bus voltage and unit on the right
+  SEG7_InitField(&big_current, 0, 0, SSD1306_HEIGHT);
+  UI_InitFieldRight(&big_fields[0], SSD1306_WIDTH, 0, &PageFont_6x10);
+  UI_InitFieldRight(&big_fields[1], SSD1306_WIDTH, SSD1306_HEIGHT - 10,
+                    &PageFont_6x10);
+  UI_SetText(&big_fields[1], "A");
+  GRAPH_Init(&current_graph);
+
+  APP_ApplySettings();
+  ADAPT_Init(&adapt, &APP_AdaptConfig);
+  // Start fast, the first slow report would wait for several slow samples.
+  // The controller backs off to slow mode once the current is quiet.
+  ADAPT_Boost(&adapt);
+  INA219_SetConfig(ADAPT_GetProfile(&adapt)->config);
+  APP_Boot.sensor = APP_GetMicros();
+
+  // The first sample is read one interval later, after a full conversion
+  uint32_t lastSample = APP_TickMs;
+  uint32_t lastFrame = 0;
+  uint32_t lastEvent = 0;
+  uint32_t lastReport = 0;
+  uint8_t eventPage = 0;
+  uint8_t page = 0xFF;    // APP_PAGE_* on screen, none yet
+  uint8_t changed = 0;    // values changed since the last frame
+  uint8_t flash = 0;
+  int current = 0;    // mA, last report
+  int busVoltage = 0; // mV, last report
+  int power = 0;      // mW, last report
+  int energy = 0;     // mWh since power-up
+  uint32_t energyUj = 0; // energy below 1 mWh
+  uint8_t sequence = 0;  // of the binary records
   while (1) {
-    int shuntVoltage = INA219_ReadShuntVoltage() * 10; // uV
-    int busVoltage = INA219_ReadBusVoltage() * 4; // mV
-    int current = shuntVoltage * CURRENT_CALIBRATION; // mA
-    int power = current * busVoltage / 1000; // mW
-    if (power < 0) {
-      power = -power;
-    }
-    APP_PrintString("Shunt Voltage: ");
-    APP_PrintInt(shuntVoltage);
-    APP_PrintString(" uV\n");
-    APP_PrintString("Bus Voltage: ");
-    APP_PrintInt(busVoltage);
-    APP_PrintString(" mV\n");
-    APP_PrintString("Current: ");
-    APP_PrintInt(current);
-    APP_PrintString(" mA\n");
-    APP_PrintString("Power: ");
-    APP_PrintInt(power);
-    APP_PrintString(" mW\n\n");
-
-    SSD1306_Fill(0);
-
-    char buf[32] = {0};
-    if (current < 0) {
-      sprintf(buf, "-%d.%dA", -current / 1000, -current % 1000);
-    } else {
-      sprintf(buf, "%d.%dA", current / 1000, current % 1000);
-    }
-    SSD1306_GotoXY(0, 5);
-    SSD1306_Puts(buf, &Font_6x10, 1);
-    
-    memset(buf, 0, sizeof(buf));
-    sprintf(buf, "%d.%dV", busVoltage / 1000, busVoltage % 1000);
-    SSD1306_GotoXY(0, 20);
-    SSD1306_Puts(buf, &Font_6x10, 1);
-
-    memset(buf, 0, sizeof(buf));
-    sprintf(buf, "%d.%dW", power / 1000, power % 1000);
-    SSD1306_GotoXY(50, 8);
-    SSD1306_Puts(buf, &Font_11x18, 1);
-
-    SSD1306_UpdateScreen();
-    LL_mDelay(100);
-  }
-}
-
-static void APP_PrintInt(int num) {
-  // Print the number to str
-  if (num < 0) {
-    num = -num;
-    putchar('-');
+    if (APP_TickMs - lastSample < ADAPT_GetProfile(&adapt)->interval) {
+      // Stream the display in chunks and take commands while waiting for
+      // the next sample
+      UI_Poll();
+      APP_PollSerial();
+      continue;
+    }
+    lastSample = APP_TickMs;
+
+    int16_t shunt = INA219_ReadShuntVoltage();
+    uint32_t now = APP_GetMicros();
+    // Flags of the binary record, the mode is the one the sample was taken in
+    uint8_t flags = adapt.mode == ADAPT_MODE_FAST ? TELEM_FLAG_FAST : 0;
+    if (APP_Boot.sample == 0) {
+      APP_Boot.sample = now;
+    }
+    uint8_t alarmEvents = ALARM_CheckShunt(&alarm, shunt, now);
+    if (alarmEvents & ALARM_EVENT_TRIP) {
+      APP_PrintString("Alarm: over-current\n\n");
+    }
+    int16_t bus = INA219_ReadBusVoltage();
+    uint8_t powerEvents = ALARM_CheckPower(&alarm, shunt, bus);
+    if (powerEvents & ALARM_EVENT_TRIP) {
+      APP_PrintString("Alarm: over-power\n\n");
+    } else if (powerEvents & ALARM_EVENT_CLEAR) {
+      char text[APP_TEXT_LEN];
+      strcpy(text, "Alarm: cleared, max check interval ");
+      APP_PrintText(text, FMT_Fixed(text + strlen(text), alarm.maxGap, 0, 0,
+                                    0, " us\n\n"));
+    }
+    alarmEvents |= powerEvents;
+    int sampleCurrent = shunt * APP_Settings.shuntLsb / 1000; // mA
+
+    // The INA219 averages in slow mode, fast mode samples are filtered here
+    int16_t reportShunt = shunt;
+    if (adapt.mode == ADAPT_MODE_FAST) {
+      reportShunt = FILTER_Update(&shunt_filter, shunt);
+    }
+    GRAPH_Add(&current_graph, sampleCurrent);
+    uint8_t events = ADAPT_Update(&adapt, reportShunt, bus, sampleCurrent);
+    uint8_t vbusEvents = VBUS_Update(&vbus_log, now, bus * 4);
+    if (vbusEvents & VBUS_EVENT_START) {
+      // Resolve the transition at the fast sample rate
+      events |= ADAPT_Boost(&adapt);
+    }
+    if (alarmEvents & ALARM_EVENT_NEAR) {
+      // Close to a limit, check it at the fast sample rate
+      events |= ADAPT_Boost(&adapt);
+    }
+    if (vbusEvents & VBUS_EVENT_LOGGED) {
+      flags |= TELEM_FLAG_VBUS;
+      APP_DumpEvents();
+      lastEvent = APP_TickMs;
+      eventPage = 1;
+      changed = 1;
+    }
+    if (events & ADAPT_EVENT_MODE) {
+      INA219_SetConfig(ADAPT_GetProfile(&adapt)->config);
+      FILTER_Reset(&shunt_filter, shunt);
+      if (adapt.mode == ADAPT_MODE_FAST) {
+        APP_PrintString("Mode: fast\n\n");
+      } else {
+        APP_PrintString("Mode: slow\n\n");
+      }
+    }
+
+    if (PERIOD_Update(&period_detector, now, sampleCurrent) &&
+        PERIOD_IsLocked(&period_detector)) {
+      PERIOD_Result *cycle = &period_detector.result;
+      char text[APP_TEXT_LEN];
+      strcpy(text, "Period: ");
+      char *p = FMT_Fixed(text + 8, cycle->period, 0, 0, 0, " us\nDuty: ");
+      p = FMT_Fixed(p, cycle->duty, 0, 0, 0, " permille\nCycle Average: ");
+      p = FMT_Fixed(p, cycle->average, 0, 0, 0, " mA\nCycle Peak: ");
+      APP_PrintText(text, FMT_Fixed(p, cycle->peak, 0, 0, 0, " mA\n\n"));
+    }
+
+    if (events & ADAPT_EVENT_REPORT) {
+      flags |= TELEM_FLAG_REPORT;
+      int shuntVoltage = adapt.shunt * 10; // uV
+      busVoltage = adapt.bus * 4; // mV
+      current = adapt.shunt * APP_Settings.shuntLsb / 1000; // mA
+      power = current * busVoltage / 1000; // mW
+      if (power < 0) {
+        power = -power;
+      }
+      // mW * ms = uJ, at most 100W over a few seconds per report
+      energyUj += (uint32_t)power * (APP_TickMs - lastReport);
+      while (energyUj >= 3600000) {
+        energyUj -= 3600000;
+        energy++;
+      }
+      changed = 1;
+      // The whole report in one write, kept or dropped as a unit
+      char text[APP_TEXT_LEN];
+      strcpy(text, "Shunt Voltage: ");
+      char *p = FMT_Fixed(text + 15, shuntVoltage, 0, 0, 0,
+                          " uV\nBus Voltage: ");
+      p = FMT_Fixed(p, busVoltage, 0, 0, 0, " mV\nCurrent: ");
+      p = FMT_Fixed(p, current, 0, 0, 0, " mA\nPower: ");
+      p = FMT_Fixed(p, power, 0, 0, 0, " mW\nEnergy: ");
+      APP_PrintText(text, FMT_Fixed(p, energy, 0, 0, 0, " mWh\n\n"));
+      lastReport = APP_TickMs;
+      if (APP_Boot.report == 0) {
+        APP_Boot.report = APP_GetMicros();
+        // Show the first reading right away instead of at the next frame
+        lastFrame = APP_TickMs - APP_FRAME_INTERVAL;
+      }
+    }
+
+    if (APP_Streaming && APP_Settings.output != APP_OUTPUT_TEXT) {
+      TELEM_Sample record = {now, shunt, bus, flags, sequence++};
+      uint8_t frame[TELEM_BLOCK_FRAME_SIZE];
+      if (alarm.cause) {
+        record.flags |= TELEM_FLAG_ALARM;
+      }
+      if (APP_Settings.output == APP_OUTPUT_BINARY) {
+        APP_Write(frame, TELEM_EncodeSample(frame, &record));
+      } else if (TELEM_AddSample(&sample_block, &record,
+                                 ADAPT_GetProfile(&adapt)->interval * 1000)) {
+        APP_Write(frame, TELEM_EncodeBlock(frame, &sample_block));
+      }
+    }
+
+    if (APP_Boot.report && APP_TickMs - lastFrame >= APP_FRAME_INTERVAL) {
+      lastFrame = APP_TickMs;
+      if (alarm.cause || flash) {
+        // Flash the whole panel while the alarm is active
+        flash = alarm.cause ? !flash : 0;
+        SSD1306_InvertDisplay(flash);
+      }
+      if (eventPage && APP_TickMs - lastEvent >= APP_EVENT_PAGE_TIME) {
+        eventPage = 0;
+      }
+      // One graph column per frame
+      GRAPH_Push(&current_graph);
+      uint8_t show = APP_PAGE_EVENTS;
+      if (!eventPage) {
+        static const uint8_t rotation[] = {APP_PAGE_MAIN, APP_PAGE_BIG,
+                                           APP_PAGE_GRAPH};
+        show = rotation[APP_TickMs / APP_PAGE_TIME % sizeof(rotation)];
+      }
+      if (show != page) {
+        page = show;
+        changed = 1;
+        if (page == APP_PAGE_EVENTS) {
+          UI_SetScreen(event_screen,
+                       sizeof(event_screen) / sizeof(event_screen[0]));
+        } else if (page == APP_PAGE_GRAPH) {
+          UI_SetScreen(graph_screen,
+                       sizeof(graph_screen) / sizeof(graph_screen[0]));
+        } else if (page == APP_PAGE_BIG) {
+          UI_SetScreen(big_screen, sizeof(big_screen) / sizeof(big_screen[0]));
+        } else {
+          UI_SetScreen(main_screen,
+                       sizeof(main_screen) / sizeof(main_screen[0]));
+        }
+      }
+      if (page == APP_PAGE_GRAPH) {
+        // New columns arrive every frame, the labels only redraw on change
+        APP_DrawGraph(current);
+      }
+      // Unchanged values cost neither rendering nor bus time
+      if (changed) {
+        changed = 0;
+        if (page == APP_PAGE_EVENTS) {
+          APP_DrawEvents();
+        } else if (page == APP_PAGE_MAIN) {
+          APP_DrawMain(current, busVoltage, power, energy);
+        } else if (page == APP_PAGE_BIG) {
+          APP_DrawBig(current, busVoltage);
+        }
+      }
+      if (UI_Flush() && APP_Boot.frame == 0) {
+        // Finish the first frame right away and report the boot timeline
+        while (UI_Poll())
+          ;
+        APP_Boot.frame = APP_GetMicros();
+        APP_PrintBoot();
+      }
+    }
   }
-  if (num / 10 != 0) {
-    APP_PrintInt(num / 10);
+}
+
+static void APP_DrawMain(int current, int busVoltage, int power, int energy) {
+  // Tabular digits keep the digits in place, so only changed digits redraw
+  char buf[UI_FIELD_LEN + 1];
+  FMT_Fixed(buf, current, 3, 3, 0, "A");
+  UI_SetText(&main_fields[0], buf);
+  FMT_Fixed(buf, busVoltage, 3, 3, 0, "V");
+  UI_SetText(&main_fields[1], buf);
+  FMT_Auto(buf, energy, 0, "Wh");
+  UI_SetText(&main_fields[2], buf);
+  FMT_Auto(buf, power, 0, "W");
+  UI_SetText(&main_fields[3], buf);
+}
+
+static void APP_DrawEvents(void) {
+  char buf[UI_FIELD_LEN + 1];
+  for (uint8_t i = 0; i < SSD1306_HEIGHT / 8; i++) {
+    const VBUS_Event *event = VBUS_GetEvent(&vbus_log, i);
+    buf[0] = '\0';
+    if (event != NULL) {
+      char *p = FMT_Fixed(buf, event->from, 3, 2, 0, ">");
+      p = FMT_Fixed(p, event->to, 3, 2, 0, "V ");
+      FMT_Fixed(p, event->rise, 3, 0, 0, "ms");
+    }
+    UI_SetText(&event_fields[i], buf);
+  }
+}
+
+static void APP_DrawGraph(int current) {
+  char buf[UI_FIELD_LEN + 1];
+  if (GRAPH_Render(&current_graph)) {
+    UI_Refresh();
+  }
+  FMT_Fixed(buf, current_graph.hi, 3, 2, 6, "A");
+  UI_SetText(&graph_fields[0], buf);
+  FMT_Fixed(buf, current, 3, 2, 6, "A");
+  UI_SetText(&graph_fields[1], buf);
+  FMT_Fixed(buf, current_graph.lo, 3, 2, 6, "A");
+  UI_SetText(&graph_fields[2], buf);
+}
+
+static void APP_DrawBig(int current, int busVoltage) {
+  char buf[UI_FIELD_LEN + 1];
+  // Four digits, with as many decimals as the integer part leaves room for
+  // once rounded; a minus sign takes the place of one digit
+  uint32_t magnitude = current < 0 ? -current : current;
+  uint8_t decimals = current < 0 ? 2 : 3;
+  uint32_t unit = current < 0 ? 10 : 1; // mA of the last digit
+  uint32_t limit = current < 0 ? 1000 : 10000;
+  while (decimals > 0 && (magnitude + unit / 2) / unit >= limit) {
+    decimals--;
+    unit *= 10;
+  }
+  FMT_Fixed(buf, current, 3, decimals, 0, "");
+  SEG7_SetText(&big_current, buf);
+  FMT_Fixed(buf, busVoltage, 3, 2, 0, "V");
+  UI_SetText(&big_fields[0], buf);
+}
+
+static void APP_DumpEvents(void) {
+  APP_PrintString("VBus Events:\n");
+  for (uint8_t i = 0; i < VBUS_LOG_SIZE; i++) {
+    const VBUS_Event *event = VBUS_GetEvent(&vbus_log, i);
+    if (event == NULL) {
+      break;
+    }
+    char text[APP_TEXT_LEN];
+    strcpy(text, "  ");
+    char *p = FMT_Fixed(text + 2, event->time, 0, 0, 0, " ms: ");
+    p = FMT_Fixed(p, event->from, 0, 0, 0, " mV -> ");
+    p = FMT_Fixed(p, event->to, 0, 0, 0, " mV, rise ");
+    p = FMT_Fixed(p, event->rise, 0, 0, 0, " us, overshoot ");
+    APP_PrintText(text, FMT_Fixed(p, event->overshoot, 0, 0, 0, " mV\n"));
+  }
+  APP_PrintString("\n");
+}
+
+static void APP_WaitForDevice(uint8_t addr, uint32_t timeout) {
+  uint32_t start = APP_TickMs;
+  while (SWIIC_CheckDevice(&swiic_config, addr) != SWIIC_OK &&
+         APP_TickMs - start < timeout)
+    ;
+}
+
+static void APP_PrintBoot(void) {
+  char text[APP_TEXT_LEN];
+  strcpy(text, "Boot: display ");
+  char *p = FMT_Fixed(text + 14, APP_Boot.display, 0, 0, 0, " us, sensor ");
+  p = FMT_Fixed(p, APP_Boot.sensor, 0, 0, 0, " us, first sample ");
+  p = FMT_Fixed(p, APP_Boot.sample, 0, 0, 0, " us, first report ");
+  p = FMT_Fixed(p, APP_Boot.report, 0, 0, 0, " us, first frame ");
+  APP_PrintText(text, FMT_Fixed(p, APP_Boot.frame, 0, 0, 0, " us\n"));
+
+  // Diagnostics that do not need to hold up the first reading
+  uint32_t integerCycles;
+  uint32_t filterCycles = FILTER_Benchmark(&integerCycles);
+  strcpy(text, "Filter: ");
+  p = FMT_Fixed(text + 8, filterCycles, 0, 0, 0, " cycles/sample, integer ");
+  APP_PrintText(text,
+                FMT_Fixed(p, integerCycles, 0, 0, 0, " cycles/sample\n\n"));
+}
+
+// Queues text up to end in one write, which the UART keeps or drops whole,
+// so a line never goes out cut
+static void APP_PrintText(const char *text, const char *end) {
+  // Text would only corrupt the binary stream
+  if (!APP_Streaming || APP_Settings.output != APP_OUTPUT_TEXT) {
+    return;
+  }
+  UART_Write(text, end - text);
+}
+
+static void APP_PrintString(const char *str) {
+  APP_PrintText(str, str + strlen(str));
+}
+
+static void APP_Write(const uint8_t *data, uint16_t len) {
+  UART_Write(data, len);
+}
+
+static void APP_PollSerial(void) {
+  uint8_t byte;
+  // Bytes stay in the receive ring while a reply waits for room
+  while (SHELL_Execute(&serial_shell) && UART_Read(&byte)) {
+    SHELL_Input(&serial_shell, byte);
+  }
+  BAUD_Poll(&serial_link, APP_TickMs);
+}
+
+static void APP_InitAlarm(void) {
+  // Limits in raw units: shunt LSB, and shunt LSB * bus LSB (4mV)
+  ALARM_Init(&alarm, ALARM_CURRENT_LIMIT * 1000 / APP_Settings.shuntLsb,
+             ALARM_POWER_LIMIT * 1000 / APP_Settings.shuntLsb * 250);
+}
+
+// Derives the sampling profiles from the settings
+static void APP_ApplySettings(void) {
+  APP_AdaptConfig = ADAPT_DefaultConfig;
+  int32_t *intervals[2] = {&APP_Settings.slowMs, &APP_Settings.fastMs};
+  int32_t adc[2] = {APP_Settings.slowAdc, APP_Settings.fastAdc};
+  for (uint8_t mode = 0; mode < 2; mode++) {
+    ADAPT_Profile *profile = &APP_AdaptConfig.profiles[mode];
+    if (*intervals[mode] < APP_AdcTime[adc[mode]]) {
+      *intervals[mode] = APP_AdcTime[adc[mode]];
+    }
+    profile->config =
+        INA219_CONFIG(APP_AdcModes[adc[mode]], APP_AdcModes[adc[mode]]);
+    profile->interval = *intervals[mode];
+  }
+  ADAPT_Profile *slow = &APP_AdaptConfig.profiles[ADAPT_MODE_SLOW];
+  slow->decimate = slow->interval < APP_SLOW_REPORT_MS
+                       ? APP_SLOW_REPORT_MS / slow->interval
+                       : 1;
+}
+
+static void APP_SettingChanged(const SHELL_Var *var) {
+  if (var->value == &APP_Settings.output) {
+    APP_FlushBlock();
+  } else if (var->value == &APP_Settings.shuntLsb) {
+    APP_InitAlarm();
+  } else {
+    APP_ApplySettings();
+    INA219_SetConfig(ADAPT_GetProfile(&adapt)->config);
+  }
+}
+
+static uint16_t APP_ShellWrite(const void *data, uint16_t len) {
+  // Output is held during a rate change, a reply would never fit. Drop it
+  // rather than stall the shell, which has to read "baud ok".
+  if (serial_link.state != BAUD_STATE_IDLE) {
+    return len;
+  }
+  if (APP_Settings.output != APP_OUTPUT_TEXT) {
+    // Between binary frames a line ends with the frame delimiter too, or the
+    // decoder would take it for the start of the next frame
+    uint8_t line[APP_LINE_LEN + 1];
+    memcpy(line, data, len);
+    line[len] = 0;
+    return UART_Write(line, len + 1) ? len : 0;
+  }
+  return UART_Write(data, len);
+}
+
+// Sends the samples of a partial delta block, e.g. before the stream stops
+static void APP_FlushBlock(void) {
+  uint8_t frame[TELEM_BLOCK_FRAME_SIZE];
+  APP_Write(frame, TELEM_EncodeBlock(frame, &sample_block));
+}
+
+static uint8_t APP_Stream(uint8_t argc, char **argv, uint8_t index,
+                          char *reply) {
+  if (argc != 2) {
+    return SHELL_USAGE;
   }
-  putchar(num % 10 + '0');
+  if (strcmp(argv[1], "start") == 0) {
+    APP_Streaming = 1;
+  } else if (strcmp(argv[1], "stop") == 0) {
+    APP_FlushBlock();
+    APP_Streaming = 0;
+  } else {
+    return SHELL_USAGE;
+  }
+  strcpy(reply, "ok");
+  return SHELL_DONE;
 }
 
-static void APP_PrintString(char *str) {
-  while (*str) {
-    putchar(*str++);
+// Two counters per line, "<name> <value> <name> <value>"
+static uint8_t APP_Stats(uint8_t argc, char **argv, uint8_t index,
+                         char *reply) {
+  const UI_Stats *ui = UI_GetStats();
+  const UART_Stats *serial = UART_GetStats();
+  const struct {
+    const char *name;
+    uint32_t value;
+  } stats[] = {
+      {"frames ", ui->frames},
+      {" skipped ", ui->skipped},
+      {"deferred ", ui->deferred},
+      {" glyphs ", ui->glyphs},
+      {"reused ", ui->reused},
+      {" max_poll_us ", ui->maxPoll},
+      {"tx_bytes ", serial->queued},
+      {" tx_dropped ", serial->dropped},
+      {"tx_peak ", serial->peak},
+      {" rx_overrun ", serial->overrun},
+      {"lines ", serial_shell.lines},
+      {" errors ", serial_shell.errors},
+      {"baud ", serial_link.rate},
+      {" fallbacks ", serial_link.fallbacks},
+      {"switches ", adapt.switches},
+      {" alarm_gap_us ", alarm.maxGap},
+      {"render_us ", ui->time},
+      {" uptime_ms ", APP_TickMs},
+  };
+  const uint8_t lines = sizeof(stats) / sizeof(stats[0]) / 2;
+  char *p = reply;
+  for (uint8_t i = index * 2; i < index * 2 + 2; i++) {
+    strcpy(p, stats[i].name);
+    p = FMT_Fixed(p + strlen(p), stats[i].value, 0, 0, 0, "");
   }
+  return index + 1 < lines ? SHELL_MORE : SHELL_DONE;
+}
+
+// "events <count>", then "<time> ms <from> -> <to> mV rise <rise> us" for
+// each, newest first
+static uint8_t APP_Events(uint8_t argc, char **argv, uint8_t index,
+                          char *reply) {
+  if (index == 0) {
+    strcpy(reply, "events ");
+    FMT_Fixed(reply + 7, vbus_log.count, 0, 0, 0, "");
+    return vbus_log.count ? SHELL_MORE : SHELL_DONE;
+  }
+  const VBUS_Event *event = VBUS_GetEvent(&vbus_log, index - 1);
+  char *p = FMT_Fixed(reply, event->time, 0, 0, 0, " ms ");
+  p = FMT_Fixed(p, event->from, 0, 0, 0, " -> ");
+  p = FMT_Fixed(p, event->to, 0, 0, 0, " mV rise ");
+  FMT_Fixed(p, event->rise, 0, 0, 0, " us");
+  return index < vbus_log.count ? SHELL_MORE : SHELL_DONE;
+}
+
+static uint8_t APP_Baud(uint8_t argc, char **argv, uint8_t index,
+                        char *reply) {
+  if (argc > 2) {
+    return SHELL_USAGE;
+  }
+  // Not a reply line, the handshake answers on its own, see baud.h
+  BAUD_Command(&serial_link, argc == 2 ? argv[1] : "");
+  return SHELL_DONE;
 }
 
 static void APP_SPrintInt(char *str, int num) {
@@ -194,6 +834,16 @@ void APP_I2C_Transmit(uint8_t devAddress, uint8_t memAddress, uint8_t *pData,
   SWIIC_WriteBytes8(&swiic_config, devAddress, memAddress, pData, len);
 }
 
+uint32_t APP_GetMicros(void) {
+  uint32_t ms, ticks;
+  // Retry if the millisecond counter rolled over while reading the SysTick
+  do {
+    ms = APP_TickMs;
+    ticks = SysTick->VAL;
+  } while (ms != APP_TickMs);
+  return ms * 1000 + (SysTick->LOAD - ticks) / (SystemCoreClock / 1000000);
+}
+
 void APP_ErrorHandler(void) {
   while (1)
     ;
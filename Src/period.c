@@ -0,0 +1,90 @@
+#include "period.h"
+#include <string.h>
+
+void PERIOD_Init(PERIOD_Detector *det) { memset(det, 0, sizeof(*det)); }
+
+uint8_t PERIOD_Update(PERIOD_Detector *det, uint32_t time, int32_t current) {
+  int32_t scaled = current * (1 << PERIOD_DECAY_SHIFT);
+  if (!det->started) {
+    det->high = det->low = scaled;
+    det->last = current;
+    det->lastTime = time;
+    det->peak = current;
+    det->started = 1;
+    return 0;
+  }
+
+  // Envelope follows new extremes immediately and relaxes towards the other
+  // side slowly, so the threshold tracks load changes without chattering.
+  // In fractional mA a small swing still decays, at the rate of a large one.
+  int32_t decay = (det->high - det->low) >> PERIOD_DECAY_SHIFT;
+  if (decay < 1) {
+    decay = 1;
+  }
+  det->high = scaled > det->high - decay ? scaled : det->high - decay;
+  det->low = scaled < det->low + decay ? scaled : det->low + decay;
+
+  // Trapezoidal integral, halved when the cycle is closed
+  det->sum += (int64_t)(det->last + current) * (uint32_t)(time - det->lastTime);
+  if (current > det->peak) {
+    det->peak = current;
+  }
+  det->last = current;
+  det->lastTime = time;
+
+  int32_t swing = (det->high - det->low) >> PERIOD_DECAY_SHIFT;
+  if (swing < PERIOD_MIN_SWING) {
+    // Flat signal, nothing to lock onto
+    det->lock = 0;
+    det->primed = 0;
+    return 0;
+  }
+  int32_t mid = (det->low >> PERIOD_DECAY_SHIFT) + swing / 2;
+  int32_t hyst = swing >> 3;
+
+  if (det->state == PERIOD_STATE_HIGH) {
+    if (current < mid - hyst) {
+      det->fallTime = time;
+      det->state = PERIOD_STATE_LOW;
+    }
+    return 0;
+  }
+  if (current <= mid + hyst) {
+    return 0;
+  }
+
+  // Rising edge: closes the running cycle
+  uint8_t done = 0;
+  if (det->primed) {
+    uint32_t period = time - det->riseTime;
+    uint32_t highTime = det->fallTime - det->riseTime;
+    if (period > 0) {
+      uint32_t prev = det->result.period;
+      uint32_t diff = period > prev ? period - prev : prev - period;
+      if (diff <= (prev >> 3)) {
+        if (det->lock < 255) {
+          det->lock++;
+        }
+      } else {
+        det->lock = 0;
+      }
+      det->result.period = period;
+      det->result.duty = (uint16_t)((uint64_t)highTime * 1000 / period);
+      det->result.average = (int32_t)(det->sum / ((int64_t)period * 2));
+      det->result.peak = det->peak;
+      det->result.cycles++;
+      done = 1;
+    }
+  }
+  det->sum = 0;
+  det->peak = current;
+  det->riseTime = time;
+  det->fallTime = time;
+  det->primed = 1;
+  det->state = PERIOD_STATE_HIGH;
+  return done;
+}
+
+uint8_t PERIOD_IsLocked(const PERIOD_Detector *det) {
+  return det->lock >= PERIOD_LOCK_CYCLES;
+}
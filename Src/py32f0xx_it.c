@@ -23,6 +23,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "py32f0xx_it.h"
+#include "uart.h"
 
 /* Private includes ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
@@ -72,6 +73,7 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
+  APP_TickMs++;
 }
 
 /******************************************************************************/
@@ -80,5 +82,12 @@ void SysTick_Handler(void)
 /* For the available peripheral interrupt handler names,                      */
 /* please refer to the startup file.                                          */
 /******************************************************************************/
+/**
+  * @brief This function handles USART1 interrupt.
+  */
+void USART1_IRQHandler(void)
+{
+  UART_IRQHandler();
+}
 
 /************************ (C) COPYRIGHT Puya *****END OF FILE******************/
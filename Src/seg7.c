@@ -0,0 +1,194 @@
+#include "seg7.h"
+#include "ui.h"
+
+// Segment bits: a top, b upper right, c lower right, d bottom, e lower left,
+// f upper left, g middle
+#define SEG7_A 0x01
+#define SEG7_B 0x02
+#define SEG7_C 0x04
+#define SEG7_D 0x08
+#define SEG7_E 0x10
+#define SEG7_F 0x20
+#define SEG7_G 0x40
+
+static const uint8_t SEG7_Digits[10] = {
+    SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_E | SEG7_F,          // 0
+    SEG7_B | SEG7_C,                                              // 1
+    SEG7_A | SEG7_B | SEG7_D | SEG7_E | SEG7_G,                   // 2
+    SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_G,                   // 3
+    SEG7_B | SEG7_C | SEG7_F | SEG7_G,                            // 4
+    SEG7_A | SEG7_C | SEG7_D | SEG7_F | SEG7_G,                   // 5
+    SEG7_A | SEG7_C | SEG7_D | SEG7_E | SEG7_F | SEG7_G,          // 6
+    SEG7_A | SEG7_B | SEG7_C,                                     // 7
+    SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_E | SEG7_F | SEG7_G, // 8
+    SEG7_A | SEG7_B | SEG7_C | SEG7_D | SEG7_F | SEG7_G,          // 9
+};
+
+typedef struct {
+  uint8_t height;
+  uint8_t stroke;
+  uint8_t digit; // width of a digit cell without the space
+  uint8_t space; // columns after each character
+} SEG7_Geometry;
+
+// Geometry of the last height used, saves the divisions on the M0+
+static SEG7_Geometry SEG7_Cache;
+
+static const SEG7_Geometry *SEG7_GetGeometry(uint8_t height) {
+  if (SEG7_Cache.height != height) {
+    uint8_t stroke = (height + 4) / 9;
+    SEG7_Cache.height = height;
+    SEG7_Cache.stroke = stroke ? stroke : 1;
+    SEG7_Cache.digit = (height * 9 + 8) / 16;
+    SEG7_Cache.space = SEG7_Cache.stroke / 2 + 1;
+  }
+  return &SEG7_Cache;
+}
+
+// Column bits of rows first to first + count - 1
+static uint32_t SEG7_Rows(uint8_t first, uint8_t count) {
+  return (count >= 32 ? 0xFFFFFFFFUL : (1UL << count) - 1) << first;
+}
+
+uint8_t SEG7_CharWidth(char ch, uint8_t height) {
+  const SEG7_Geometry *g = SEG7_GetGeometry(height);
+  return (ch == '.' ? g->stroke : g->digit) + g->space;
+}
+
+uint8_t SEG7_TextWidth(const char *text, uint8_t height) {
+  uint8_t width = 0;
+  for (; *text; text++) {
+    width += SEG7_CharWidth(*text, height);
+  }
+  return width;
+}
+
+uint8_t SEG7_DrawChar(int16_t x, int16_t y, uint8_t height, char ch) {
+  const SEG7_Geometry *g = SEG7_GetGeometry(height);
+  uint8_t t = g->stroke;
+  uint8_t mid = (height - t) / 2;
+  uint8_t bottom = height - t;
+  uint32_t mask = SEG7_Rows(0, height);
+  // A cell has only three kinds of columns: the left stroke (segments f and
+  // e), the middle (a, g and d) and the right stroke (b and c)
+  uint32_t left = 0, middle = 0, right = 0;
+  uint8_t width = g->digit;
+
+  if (ch == '.') {
+    middle = SEG7_Rows(bottom, t);
+    width = t;
+  } else {
+    uint8_t segments = 0;
+    if (ch >= '0' && ch <= '9') {
+      segments = SEG7_Digits[ch - '0'];
+    } else if (ch == '-') {
+      segments = SEG7_G;
+    }
+    uint32_t upper = SEG7_Rows(t, mid - t);
+    uint32_t lower = SEG7_Rows(mid + t, bottom - mid - t);
+    if (segments & SEG7_A) {
+      middle |= SEG7_Rows(0, t);
+    }
+    if (segments & SEG7_B) {
+      right |= upper;
+    }
+    if (segments & SEG7_C) {
+      right |= lower;
+    }
+    if (segments & SEG7_D) {
+      middle |= SEG7_Rows(bottom, t);
+    }
+    if (segments & SEG7_E) {
+      left |= lower;
+    }
+    if (segments & SEG7_F) {
+      left |= upper;
+    }
+    if (segments & SEG7_G) {
+      middle |= SEG7_Rows(mid, t);
+    }
+  }
+
+  // Every column of the cell is written, so any previous character is
+  // overwritten; segments that do not change stay clean
+  if (width == t) {
+    SSD1306_Run_t runs[] = {{t, middle}, {g->space, 0}};
+    SSD1306_FillRuns(x, y, runs, 2, mask);
+  } else {
+    SSD1306_Run_t runs[] = {
+        {t, left}, {width - 2 * t, middle}, {t, right}, {g->space, 0}};
+    SSD1306_FillRuns(x, y, runs, 4, mask);
+  }
+  return width + g->space;
+}
+
+void SEG7_InitField(SEG7_Field *field, uint8_t x, uint8_t y, uint8_t height) {
+  memset(field, 0, sizeof(*field));
+  field->x = x;
+  field->y = y;
+  field->height = height;
+  field->end = x;
+}
+
+void SEG7_DrawField(void *object) {
+  SEG7_Field *field = object;
+  int16_t x = field->x;
+  for (const char *c = field->text; *c; c++) {
+    x += SEG7_DrawChar(x, field->y, field->height, *c);
+  }
+}
+
+#ifdef SSD1306_PAGE_MODE
+uint8_t SEG7_SetText(SEG7_Field *field, const char *text) {
+  uint8_t changed = 0;
+  uint8_t i;
+  // Only remember the text, the next frame renders it from the screen list
+  for (i = 0; i < SEG7_FIELD_LEN && text[i]; i++) {
+    if (field->text[i] != text[i]) {
+      field->text[i] = text[i];
+      changed++;
+    }
+  }
+  if (field->text[i] != '\0') {
+    field->text[i] = '\0';
+    changed++;
+  }
+  if (changed) {
+    UI_Refresh();
+  }
+  return changed;
+}
+#else
+uint8_t SEG7_SetText(SEG7_Field *field, const char *text) {
+  uint8_t drawn = 0;
+  // Characters stay in place as long as every character before them kept
+  // its width; a cell that changes is rewritten whole
+  uint8_t aligned = 1;
+  uint8_t x = field->x;
+  uint8_t i;
+
+  for (i = 0; i < SEG7_FIELD_LEN && text[i]; i++) {
+    char old = aligned ? field->text[i] : '\0';
+    if (old != text[i]) {
+      if (old == '\0' ||
+          SEG7_CharWidth(old, field->height) !=
+              SEG7_CharWidth(text[i], field->height)) {
+        aligned = 0;
+      }
+      SEG7_DrawChar(x, field->y, field->height, text[i]);
+      drawn++;
+    }
+    field->text[i] = text[i];
+    x += SEG7_CharWidth(text[i], field->height);
+  }
+  field->text[i] = '\0';
+
+  // Clear what is left of a longer previous text
+  if (x < field->end) {
+    SSD1306_FillRect(x, field->y, field->end - x, field->height,
+                     SSD1306_COLOR_BLACK);
+  }
+  field->end = x;
+  return drawn;
+}
+#endif
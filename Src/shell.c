@@ -0,0 +1,269 @@
+#include "shell.h"
+#include "fmt.h"
+
+#include <string.h>
+
+// Shell of the running command, for the built-in handlers
+static SHELL_State *SHELL_Current;
+
+void SHELL_Init(SHELL_State *shell, const SHELL_Config *config) {
+  memset(shell, 0, sizeof(*shell));
+  shell->config = config;
+}
+
+uint8_t SHELL_Input(SHELL_State *shell, uint8_t byte) {
+  if (shell->ready || shell->busy) {
+    return 0;
+  }
+  if (byte == '\n' || byte == '\r') {
+    // Empty lines, such as the second half of "\r\n", are skipped
+    shell->ready = shell->len > 0;
+    return shell->ready;
+  }
+  if (shell->len < SHELL_LINE_LEN) {
+    shell->line[shell->len] = byte;
+  }
+  if (shell->len <= SHELL_LINE_LEN) {
+    shell->len++;
+  }
+  return 0;
+}
+
+uint8_t SHELL_ParseInt(const char *text, int32_t *value) {
+  uint8_t negative = *text == '-';
+  uint32_t magnitude = 0;
+  text += negative;
+  if (*text == '\0') {
+    return 0;
+  }
+  for (; *text; text++) {
+    if (*text < '0' || *text > '9' || magnitude > 100000000) {
+      return 0;
+    }
+    magnitude = magnitude * 10 + (*text - '0');
+  }
+  *value = negative ? -(int32_t)magnitude : (int32_t)magnitude;
+  return 1;
+}
+
+// Appends text to reply, up to SHELL_REPLY_LEN characters in all
+static char *SHELL_Append(char *reply, const char *text) {
+  size_t len = strlen(reply);
+  strncat(reply, text, SHELL_REPLY_LEN - len);
+  return reply + strlen(reply);
+}
+
+static uint8_t SHELL_Error(char *reply, const char *reason) {
+  SHELL_Current->errors++;
+  reply[0] = '\0';
+  SHELL_Append(reply, "error: ");
+  SHELL_Append(reply, reason);
+  return SHELL_DONE;
+}
+
+static const SHELL_Var *SHELL_FindVar(const char *name) {
+  const SHELL_Config *config = SHELL_Current->config;
+  for (uint8_t i = 0; i < config->varCount; i++) {
+    if (strcmp(config->vars[i].name, name) == 0) {
+      return &config->vars[i];
+    }
+  }
+  return NULL;
+}
+
+// "<name> <value>", variable names leave room for any number
+static void SHELL_PrintVar(const SHELL_Var *var, char *reply) {
+  reply[0] = '\0';
+  SHELL_Append(reply, var->name);
+  char *p = SHELL_Append(reply, " ");
+  if (var->names) {
+    SHELL_Append(reply, var->names[*var->value - var->min]);
+  } else {
+    FMT_Fixed(p, *var->value, 0, 0, 0, "");
+  }
+}
+
+static uint8_t SHELL_ParseValue(const SHELL_Var *var, const char *text,
+                                int32_t *value) {
+  if (var->names) {
+    for (int32_t v = var->min; v <= var->max; v++) {
+      if (strcmp(var->names[v - var->min], text) == 0) {
+        *value = v;
+        return 1;
+      }
+    }
+    return 0;
+  }
+  return SHELL_ParseInt(text, value);
+}
+
+static uint8_t SHELL_Get(uint8_t argc, char **argv, uint8_t index,
+                         char *reply) {
+  const SHELL_Config *config = SHELL_Current->config;
+  if (argc == 1) {
+    if (index < config->varCount) {
+      SHELL_PrintVar(&config->vars[index], reply);
+    }
+    return index + 1 < config->varCount ? SHELL_MORE : SHELL_DONE;
+  }
+  if (argc != 2) {
+    return SHELL_USAGE;
+  }
+  const SHELL_Var *var = SHELL_FindVar(argv[1]);
+  if (var == NULL) {
+    return SHELL_Error(reply, "unknown variable");
+  }
+  SHELL_PrintVar(var, reply);
+  return SHELL_DONE;
+}
+
+static uint8_t SHELL_Set(uint8_t argc, char **argv, uint8_t index,
+                         char *reply) {
+  if (argc != 3) {
+    return SHELL_USAGE;
+  }
+  const SHELL_Var *var = SHELL_FindVar(argv[1]);
+  int32_t value;
+  if (var == NULL) {
+    return SHELL_Error(reply, "unknown variable");
+  }
+  if (!SHELL_ParseValue(var, argv[2], &value)) {
+    return SHELL_Error(reply, "bad value");
+  }
+  if (value < var->min || value > var->max) {
+    return SHELL_Error(reply, "out of range");
+  }
+  *var->value = value;
+  if (SHELL_Current->config->changed) {
+    SHELL_Current->config->changed(var);
+  }
+  strcpy(reply, "ok");
+  return SHELL_DONE;
+}
+
+static uint8_t SHELL_Help(uint8_t argc, char **argv, uint8_t index,
+                          char *reply);
+
+static const SHELL_Command SHELL_BuiltIn[] = {
+    {"get", "[name]", SHELL_Get},
+    {"set", "<name> <value>", SHELL_Set},
+    {"help", "", SHELL_Help},
+};
+#define SHELL_BUILT_IN (sizeof(SHELL_BuiltIn) / sizeof(SHELL_BuiltIn[0]))
+
+static const SHELL_Command *SHELL_GetCommand(uint8_t i) {
+  if (i < SHELL_BUILT_IN) {
+    return &SHELL_BuiltIn[i];
+  }
+  return &SHELL_Current->config->commands[i - SHELL_BUILT_IN];
+}
+
+static void SHELL_Usage(const SHELL_Command *command, char *reply) {
+  SHELL_Append(reply, command->name);
+  if (command->usage[0]) {
+    SHELL_Append(reply, " ");
+    SHELL_Append(reply, command->usage);
+  }
+}
+
+// One line per command, then one per variable with its values
+static uint8_t SHELL_Help(uint8_t argc, char **argv, uint8_t index,
+                          char *reply) {
+  const SHELL_Config *config = SHELL_Current->config;
+  uint8_t commands = SHELL_BUILT_IN + config->commandCount;
+  if (index < commands) {
+    SHELL_Usage(SHELL_GetCommand(index), reply);
+  } else {
+    const SHELL_Var *var = &config->vars[index - commands];
+    char *p = SHELL_Append(reply, var->name);
+    if (var->names) {
+      SHELL_Append(reply, ":");
+      for (int32_t v = var->min; v <= var->max; v++) {
+        SHELL_Append(reply, " ");
+        SHELL_Append(reply, var->names[v - var->min]);
+      }
+    } else if (p + 26 <= reply + SHELL_REPLY_LEN) {
+      *p++ = ' ';
+      p = FMT_Fixed(p, var->min, 0, 0, 0, "..");
+      FMT_Fixed(p, var->max, 0, 0, 0, "");
+    }
+  }
+  return index + 1 < commands + config->varCount ? SHELL_MORE : SHELL_DONE;
+}
+
+// Splits the line into words and runs its command for the first reply line
+static void SHELL_Start(SHELL_State *shell) {
+  char *p = shell->line;
+  shell->run = NULL;
+  shell->index = 0;
+  shell->argc = 0;
+  shell->status = SHELL_DONE;
+  shell->reply[0] = '\0';
+  shell->lines++;
+  if (shell->len > SHELL_LINE_LEN) {
+    SHELL_Error(shell->reply, "line too long");
+    return;
+  }
+  shell->line[shell->len] = '\0';
+  while (*p) {
+    if (*p == ' ') {
+      *p++ = '\0';
+      continue;
+    }
+    if (shell->argc == SHELL_MAX_ARGS) {
+      SHELL_Error(shell->reply, "too many words");
+      return;
+    }
+    shell->argv[shell->argc++] = p;
+    while (*p && *p != ' ') {
+      p++;
+    }
+  }
+  if (shell->argc == 0) {
+    return;
+  }
+
+  uint8_t count = SHELL_BUILT_IN + shell->config->commandCount;
+  for (uint8_t i = 0; i < count; i++) {
+    const SHELL_Command *command = SHELL_GetCommand(i);
+    if (strcmp(command->name, shell->argv[0]) == 0) {
+      shell->run = command->run;
+      shell->status = command->run(shell->argc, shell->argv, 0, shell->reply);
+      if (shell->status == SHELL_USAGE) {
+        shell->status = SHELL_Error(shell->reply, "usage: ");
+        SHELL_Usage(command, shell->reply);
+      }
+      return;
+    }
+  }
+  SHELL_Error(shell->reply, "unknown command, try help");
+}
+
+uint8_t SHELL_Execute(SHELL_State *shell) {
+  SHELL_Current = shell;
+  if (shell->ready) {
+    shell->ready = 0;
+    shell->busy = 1;
+    SHELL_Start(shell);
+  }
+  while (shell->busy) {
+    size_t len = strlen(shell->reply);
+    if (len > 0) {
+      shell->reply[len] = '\n';
+      if (!shell->config->write(shell->reply, len + 1)) {
+        // Try again on the next call
+        shell->reply[len] = '\0';
+        return 0;
+      }
+    }
+    if (shell->status != SHELL_MORE) {
+      shell->busy = 0;
+      shell->len = 0;
+      break;
+    }
+    shell->reply[0] = '\0';
+    shell->status = shell->run(shell->argc, shell->argv, ++shell->index,
+                               shell->reply);
+  }
+  return 1;
+}
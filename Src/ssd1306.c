@@ -17,8 +17,43 @@
 /* Absolute value */
 #define ABS(x)   ((x) > 0 ? (x) : -(x))
 
+#define SSD1306_PAGES (SSD1306_HEIGHT / 8)
+
 /* SSD1306 data buffer */
-static uint8_t SSD1306_Buffer_all[SSD1306_WIDTH * SSD1306_HEIGHT / 8];
+#ifdef SSD1306_PAGE_MODE
+#ifdef SSD1306_DOUBLE_BUFFER
+#error "SSD1306_PAGE_MODE and SSD1306_DOUBLE_BUFFER are exclusive"
+#endif
+/* Only the page being streamed, see SSD1306_BeginPage. Drawing outside of
+ * it is clipped. */
+static uint8_t SSD1306_Buffer_all[SSD1306_WIDTH];
+#define SSD1306_ROW(page) ((page) == SSD1306.Page ? SSD1306_Buffer_all : NULL)
+#else
+static uint8_t SSD1306_Buffer_all[SSD1306_WIDTH * SSD1306_PAGES];
+#define SSD1306_ROW(page) (&SSD1306_Buffer_all[(page) * SSD1306_WIDTH])
+#endif
+/* Bytes on the wire per I2C transaction besides the payload:
+ * slave address and control byte */
+#define SSD1306_I2C_OVERHEAD 2
+/* Column (0x21) and page (0x22) address commands */
+#define SSD1306_WINDOW_COST (SSD1306_I2C_OVERHEAD + 6)
+
+/* Changed columns per page since the last update, clean if min > max */
+static uint8_t SSD1306_DirtyMin[SSD1306_PAGES];
+static uint8_t SSD1306_DirtyMax[SSD1306_PAGES];
+
+/* Columns per page of the frame being sent, done if min > max */
+static uint8_t SSD1306_TxMin[SSD1306_PAGES];
+static uint8_t SSD1306_TxMax[SSD1306_PAGES];
+
+#ifdef SSD1306_DOUBLE_BUFFER
+/* Copy of the presented frame, drawing continues in SSD1306_Buffer_all
+ * while this is sent */
+static uint8_t SSD1306_Front[sizeof(SSD1306_Buffer_all)];
+#define SSD1306_TX_ROW(page) (&SSD1306_Front[(page) * SSD1306_WIDTH])
+#else
+#define SSD1306_TX_ROW(page) SSD1306_ROW(page)
+#endif
 
 /* Private SSD1306 structure */
 typedef struct {
@@ -26,10 +61,20 @@ typedef struct {
     uint16_t CurrentY;
     uint8_t Inverted;
     uint8_t Initialized;
+    uint8_t FullWindow;
+    uint16_t FrameBytes;
+    uint8_t TxPage;   /* page being sent, SSD1306_PAGES when idle */
+    uint8_t TxLast;   /* last page of a bounding window */
+    uint8_t TxX;      /* next column to send */
+    uint8_t TxBox;    /* one window for all pages */
+    uint8_t TxWindow; /* window command due before the next data */
+    uint8_t Page;     /* page held in the buffer in page mode */
 } SSD1306_t;
 
 /* Private variable */
-static SSD1306_t SSD1306;
+static SSD1306_t SSD1306 = {.TxPage = SSD1306_PAGES};
+
+static void SSD1306_MarkAllDirty(void);
 
 static uint8_t SSD1306_InitCommands[] = {
     0xAE, // display off
@@ -52,22 +97,32 @@ static uint8_t SSD1306_InitCommands[] = {
 
 uint8_t SSD1306_Init(void) 
 {
-    LL_mDelay(500);
-    for (uint8_t i = 0; i < sizeof(SSD1306_InitCommands); i++)
+    /* One command stream, the controller needs no delay between commands.
+     * The panel has to be out of reset already, see APP_WaitForDevice */
+    APP_I2C_Transmit(SSD1306_I2C_ADDR, 0x00, SSD1306_InitCommands, sizeof(SSD1306_InitCommands));
+
+    /* The panel RAM holds garbage after power-up, clear all of it while the
+     * display is still off */
+#ifdef SSD1306_PAGE_MODE
+    /* Clear screen, one page at a time */
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++)
     {
-        SSD1306_WriteCommand(SSD1306_InitCommands[i]);
-        LL_mDelay(1);
+        SSD1306_BeginPage(page);
+        SSD1306_UpdateScreen();
     }
-
-    /** 0xAE, Display OFF (sleep mode), 
-     *  0xAF, Display ON in normal mode */
-    SSD1306_WriteCommand(0xAF);
-
+#else
     /* Clear screen */
     SSD1306_Fill(SSD1306_COLOR_BLACK);
+    SSD1306_MarkAllDirty();
 
     /* Update screen */
     SSD1306_UpdateScreen();
+#endif
+
+    /** 0xAE, Display OFF (sleep mode), 
+     *  0xAF, Display ON in normal mode. The charge pump ramps up on its own,
+     *  nothing to wait for */
+    SSD1306_WriteCommand(0xAF);
 
     /* Set default values */
     SSD1306.CurrentX = 0;
@@ -80,9 +135,215 @@ uint8_t SSD1306_Init(void)
     return 1;
 }
 
-void SSD1306_UpdateScreen(void) 
+static inline void SSD1306_MarkDirty(uint8_t page, uint8_t x0, uint8_t x1)
+{
+    if (x0 < SSD1306_DirtyMin[page])
+    {
+        SSD1306_DirtyMin[page] = x0;
+    }
+    if (x1 > SSD1306_DirtyMax[page])
+    {
+        SSD1306_DirtyMax[page] = x1;
+    }
+}
+
+static void SSD1306_MarkAllDirty(void)
+{
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++)
+    {
+        SSD1306_DirtyMin[page] = 0;
+        SSD1306_DirtyMax[page] = SSD1306_WIDTH - 1;
+    }
+}
+
+static void SSD1306_SetWindow(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1)
+{
+    uint8_t commands[] = {0x21, x0, x1, 0x22, page0, page1};
+    APP_I2C_Transmit(SSD1306_I2C_ADDR, 0x00, commands, sizeof(commands));
+    SSD1306.FrameBytes += SSD1306_WINDOW_COST;
+    SSD1306.FullWindow = x0 == 0 && x1 == SSD1306_WIDTH - 1 && page0 == 0 && page1 == SSD1306_PAGES - 1;
+}
+
+static void SSD1306_SendData(uint8_t *data, uint16_t len)
 {
-    APP_I2C_Transmit(SSD1306_I2C_ADDR, 0x40, SSD1306_Buffer_all, SSD1306_WIDTH * SSD1306_HEIGHT / 8);
+    APP_I2C_Transmit(SSD1306_I2C_ADDR, 0x40, data, len);
+    SSD1306.FrameBytes += SSD1306_I2C_OVERHEAD + len;
+}
+
+uint8_t SSD1306_Present(void)
+{
+    uint16_t pageCost = 0;
+    uint8_t x0 = SSD1306_WIDTH - 1, x1 = 0, page0 = SSD1306_PAGES, page1 = 0;
+
+    if (SSD1306.TxPage < SSD1306_PAGES)
+    {
+        /* Previous frame still in flight, changes stay dirty for the next */
+        return SSD1306_PRESENT_BUSY;
+    }
+#ifdef SSD1306_PAGE_MODE
+    /* The page being streamed is always sent whole */
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++)
+    {
+        SSD1306_DirtyMin[page] = 0xFF;
+        SSD1306_DirtyMax[page] = 0;
+    }
+    SSD1306_MarkDirty(SSD1306.Page, 0, SSD1306_WIDTH - 1);
+#endif
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++)
+    {
+        if (SSD1306_DirtyMin[page] > SSD1306_DirtyMax[page])
+        {
+            continue;
+        }
+        pageCost += SSD1306_WINDOW_COST + SSD1306_I2C_OVERHEAD + SSD1306_DirtyMax[page] - SSD1306_DirtyMin[page] + 1;
+        if (SSD1306_DirtyMin[page] < x0)
+        {
+            x0 = SSD1306_DirtyMin[page];
+        }
+        if (SSD1306_DirtyMax[page] > x1)
+        {
+            x1 = SSD1306_DirtyMax[page];
+        }
+        if (page0 == SSD1306_PAGES)
+        {
+            page0 = page;
+        }
+        page1 = page;
+    }
+    if (page0 == SSD1306_PAGES)
+    {
+        /* Nothing changed */
+        return SSD1306_PRESENT_IDLE;
+    }
+
+    /* Pick the cheapest of: one window per dirty page, one bounding window,
+     * or the whole screen with the full window already set */
+    uint16_t boxCost = SSD1306_WINDOW_COST + (SSD1306_I2C_OVERHEAD + x1 - x0 + 1) * (page1 - page0 + 1);
+    uint16_t fullCost = (SSD1306.FullWindow ? 0 : SSD1306_WINDOW_COST) + SSD1306_I2C_OVERHEAD + SSD1306_WIDTH * SSD1306_PAGES;
+
+    SSD1306.TxBox = 1;
+    SSD1306.TxWindow = 1;
+    if (fullCost <= boxCost && fullCost <= pageCost)
+    {
+        x0 = 0;
+        x1 = SSD1306_WIDTH - 1;
+        page0 = 0;
+        page1 = SSD1306_PAGES - 1;
+        SSD1306.TxWindow = !SSD1306.FullWindow;
+    }
+    else if (boxCost > pageCost)
+    {
+        SSD1306.TxBox = 0;
+    }
+
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++)
+    {
+        if (!SSD1306.TxBox)
+        {
+            SSD1306_TxMin[page] = SSD1306_DirtyMin[page];
+            SSD1306_TxMax[page] = SSD1306_DirtyMax[page];
+        }
+        else if (page >= page0 && page <= page1)
+        {
+            SSD1306_TxMin[page] = x0;
+            SSD1306_TxMax[page] = x1;
+        }
+        else
+        {
+            SSD1306_TxMin[page] = 0xFF;
+            SSD1306_TxMax[page] = 0;
+        }
+#ifdef SSD1306_DOUBLE_BUFFER
+        /* The front buffer mirrors everything presented so far, copying the
+         * changed bytes is enough */
+        if (SSD1306_DirtyMin[page] <= SSD1306_DirtyMax[page])
+        {
+            uint16_t offset = page * SSD1306_WIDTH + SSD1306_DirtyMin[page];
+            memcpy(&SSD1306_Front[offset], &SSD1306_Buffer_all[offset],
+                   SSD1306_DirtyMax[page] - SSD1306_DirtyMin[page] + 1);
+        }
+#endif
+        SSD1306_DirtyMin[page] = 0xFF;
+        SSD1306_DirtyMax[page] = 0;
+    }
+
+    SSD1306.FrameBytes = 0;
+    SSD1306.TxPage = page0;
+    SSD1306.TxLast = page1;
+    SSD1306.TxX = SSD1306_TxMin[page0];
+    return SSD1306_PRESENT_QUEUED;
+}
+
+uint8_t SSD1306_Poll(void)
+{
+    uint8_t page = SSD1306.TxPage;
+    uint8_t len;
+
+    if (page >= SSD1306_PAGES)
+    {
+        return 0;
+    }
+    if (SSD1306.TxWindow)
+    {
+        SSD1306_SetWindow(SSD1306_TxMin[page], SSD1306_TxMax[page], page,
+                          SSD1306.TxBox ? SSD1306.TxLast : page);
+        SSD1306.TxWindow = 0;
+        return 1;
+    }
+
+    /* The panel keeps its address pointer between transactions, so a page
+     * can be sent in several chunks */
+    len = SSD1306_TxMax[page] - SSD1306.TxX + 1;
+    if (len > SSD1306_CHUNK)
+    {
+        len = SSD1306_CHUNK;
+    }
+    SSD1306_SendData(SSD1306_TX_ROW(page) + SSD1306.TxX, len);
+    SSD1306.TxX += len;
+    if (SSD1306.TxX <= SSD1306_TxMax[page])
+    {
+        return 1;
+    }
+
+    /* Next page with data */
+    do
+    {
+        page++;
+    } while (page < SSD1306_PAGES && SSD1306_TxMin[page] > SSD1306_TxMax[page]);
+    SSD1306.TxPage = page;
+    if (page == SSD1306_PAGES)
+    {
+        return 0;
+    }
+    SSD1306.TxX = SSD1306_TxMin[page];
+    SSD1306.TxWindow = !SSD1306.TxBox;
+    return 1;
+}
+
+void SSD1306_UpdateScreen(void)
+{
+    /* Blocking: finish the previous frame, then send this one */
+    while (SSD1306_Poll())
+        ;
+    SSD1306_Present();
+    while (SSD1306_Poll())
+        ;
+}
+
+#ifdef SSD1306_PAGE_MODE
+void SSD1306_BeginPage(uint8_t page)
+{
+    /* The buffer is reused, wait until the previous page is out */
+    while (SSD1306_Poll())
+        ;
+    SSD1306.Page = page;
+    memset(SSD1306_Buffer_all, SSD1306.Inverted ? 0xFF : 0x00, sizeof(SSD1306_Buffer_all));
+}
+#endif
+
+uint16_t SSD1306_GetFrameBytes(void)
+{
+    return SSD1306.FrameBytes;
 }
 
 void SSD1306_ToggleInvert(void) 
@@ -97,6 +358,14 @@ void SSD1306_ToggleInvert(void)
     {
         SSD1306_Buffer_all[i] = ~SSD1306_Buffer_all[i];
     }
+    SSD1306_MarkAllDirty();
+}
+
+void SSD1306_InvertDisplay(uint8_t invert)
+{
+    /** 0xA6, Normal display,
+     *  0xA7, Inverse display, the frame buffer is left untouched */
+    SSD1306_WriteCommand(invert ? 0xA7 : 0xA6);
 }
 
 void SSD1306_Fill(uint8_t color)
@@ -105,8 +374,25 @@ void SSD1306_Fill(uint8_t color)
     {
         color = (uint8_t)!color;
     }
-    /* Set memory */
-    memset(SSD1306_Buffer_all, (color == SSD1306_COLOR_BLACK) ? 0x00 : 0xFF, SSD1306_WIDTH * SSD1306_HEIGHT / 8);
+    uint8_t value = (color == SSD1306_COLOR_BLACK) ? 0x00 : 0xFF;
+
+    /* Set memory, only bytes that actually change are marked dirty */
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++)
+    {
+        uint8_t *row = SSD1306_ROW(page);
+        if (row == NULL)
+        {
+            continue;
+        }
+        for (uint8_t x = 0; x < SSD1306_WIDTH; x++)
+        {
+            if (row[x] != value)
+            {
+                row[x] = value;
+                SSD1306_MarkDirty(page, x, x);
+            }
+        }
+    }
 }
 
 void SSD1306_DrawPixel(uint16_t x, uint16_t y, uint8_t color)
@@ -124,13 +410,25 @@ void SSD1306_DrawPixel(uint16_t x, uint16_t y, uint8_t color)
     }
 
     /* Set color */
+    uint8_t *row = SSD1306_ROW(y / 8);
+    if (row == NULL)
+    {
+        return;
+    }
+    uint8_t *byte = &row[x];
+    uint8_t value;
     if (color == SSD1306_COLOR_WHITE)
     {
-        SSD1306_Buffer_all[x + (y / 8) * SSD1306_WIDTH] |= 1 << (y % 8);
+        value = *byte | (1 << (y % 8));
     }
     else
     {
-        SSD1306_Buffer_all[x + (y / 8) * SSD1306_WIDTH] &= ~(1 << (y % 8));
+        value = *byte & ~(1 << (y % 8));
+    }
+    if (value != *byte)
+    {
+        *byte = value;
+        SSD1306_MarkDirty(y / 8, x, x);
     }
 }
 
@@ -141,43 +439,370 @@ void SSD1306_GotoXY(uint16_t x, uint16_t y)
     SSD1306.CurrentY = y;
 }
 
-char SSD1306_Putc(char ch, FontDef_t* font, uint8_t color)
+/* Writes one column of up to 32 pixels into the page-major buffer. bits holds
+ * the pixel values and mask the pixels to write, bit 0 being the top row at
+ * (x, y). */
+static void SSD1306_BlitColumn(uint16_t x, uint16_t y, uint32_t bits, uint32_t mask)
+{
+    uint8_t page = y / 8;
+    uint8_t shift = y % 8;
+    uint8_t *row;
+
+    if (x >= SSD1306_WIDTH)
+    {
+        return;
+    }
+    /* Top page, partially covered unless y is page-aligned */
+    uint8_t m = (uint8_t)(mask << shift);
+    uint8_t v = (uint8_t)(bits << shift);
+    bits >>= 8 - shift;
+    mask >>= 8 - shift;
+    while (page < SSD1306_PAGES)
+    {
+        row = SSD1306_ROW(page);
+        if (row != NULL)
+        {
+            /* Page-aligned text only ever hits the fast path, a plain store */
+            uint8_t value = m == 0xFF ? v : (row[x] & ~m) | (v & m);
+            if (value != row[x])
+            {
+                row[x] = value;
+                SSD1306_MarkDirty(page, x, x);
+            }
+        }
+        if (!mask)
+        {
+            break;
+        }
+        m = (uint8_t)mask;
+        v = (uint8_t)bits;
+        bits >>= 8;
+        mask >>= 8;
+        page++;
+    }
+}
+
+void SSD1306_DrawColumn(uint16_t x, uint16_t y, uint32_t bits, uint32_t mask)
+{
+    /* Check if pixels are inverted */
+    if (SSD1306.Inverted)
+    {
+        bits = ~bits;
+    }
+    SSD1306_BlitColumn(x, y, bits, mask);
+}
+
+void SSD1306_ScrollLeft(uint8_t x0, uint8_t x1, uint8_t page0, uint8_t page1, uint8_t n)
+{
+    uint8_t blank = SSD1306.Inverted ? 0xFF : 0x00;
+    uint8_t width = x1 - x0 + 1;
+
+    if (n > width)
+    {
+        n = width;
+    }
+    for (uint8_t page = page0; page <= page1 && page < SSD1306_PAGES; page++)
+    {
+        uint8_t *row = SSD1306_ROW(page);
+        if (row == NULL)
+        {
+            continue;
+        }
+        row += x0;
+        memmove(row, row + n, width - n);
+        memset(row + width - n, blank, n);
+        SSD1306_MarkDirty(page, x0, x1);
+    }
+}
+
+/* Sets the masked pixels of the bytes x0..x1 of a page to value, marking
+ * only the bytes that change */
+static void SSD1306_WriteSpan(uint8_t page, uint8_t x0, uint8_t x1, uint8_t mask, uint8_t value)
+{
+    uint8_t *row = SSD1306_ROW(page);
+    uint8_t first = 0xFF, last = 0;
+
+    if (row == NULL)
+    {
+        return;
+    }
+    /* Callers clip already, but the compiler can not prove it and warns
+     * about the vectorized writes into the one-page buffer of
+     * SSD1306_PAGE_MODE */
+    if (x1 >= SSD1306_WIDTH)
+    {
+        x1 = SSD1306_WIDTH - 1;
+    }
+    value &= mask;
+    for (uint8_t x = x0; x <= x1; x++)
+    {
+        if ((row[x] & mask) != value)
+        {
+            if (first == 0xFF)
+            {
+                first = x;
+            }
+            last = x;
+        }
+    }
+    if (first == 0xFF)
+    {
+        /* Already drawn */
+        return;
+    }
+    if (mask == 0xFF)
+    {
+        /* Whole bytes, a horizontal span of full pages */
+        memset(&row[first], value, last - first + 1);
+    }
+    else
+    {
+        for (uint8_t x = first; x <= last; x++)
+        {
+            row[x] = (row[x] & ~mask) | value;
+        }
+    }
+    SSD1306_MarkDirty(page, first, last);
+}
+
+/* Applies mask to the bytes x0..x1 of a page: sets, clears or toggles the
+ * masked pixels depending on color */
+static void SSD1306_FillSpan(uint8_t page, uint8_t x0, uint8_t x1, uint8_t mask, uint8_t color)
+{
+    uint8_t *row = SSD1306_ROW(page);
+
+    if (color != SSD1306_COLOR_INVERT)
+    {
+        SSD1306_WriteSpan(page, x0, x1, mask, color == SSD1306_COLOR_WHITE ? 0xFF : 0x00);
+        return;
+    }
+    if (row == NULL)
+    {
+        return;
+    }
+    for (uint8_t x = x0; x <= x1; x++)
+    {
+        row[x] ^= mask;
+    }
+    SSD1306_MarkDirty(page, x0, x1);
+}
+
+void SSD1306_FillColumns(int16_t x, uint16_t y, int16_t w, uint32_t bits, uint32_t mask)
+{
+    SSD1306_Run_t run;
+
+    /* Clip */
+    if (x < 0)
+    {
+        w += x;
+        x = 0;
+    }
+    if (x + w > SSD1306_WIDTH)
+    {
+        w = SSD1306_WIDTH - x;
+    }
+    if (w <= 0)
+    {
+        return;
+    }
+    run.width = w;
+    run.bits = bits;
+    SSD1306_FillRuns(x, y, &run, 1, mask);
+}
+
+/* Pixels of a column that fall into the k-th page of a span starting at row
+ * shift of its first page */
+static inline uint8_t SSD1306_PageBits(uint32_t bits, uint8_t k, uint8_t shift)
+{
+    return (uint8_t)(k == 0 ? bits << shift : bits >> (k * 8 - shift));
+}
+
+void SSD1306_FillRuns(int16_t x, uint16_t y, const SSD1306_Run_t* runs, uint8_t count, uint32_t mask)
 {
-    uint32_t i, b, j, k;
+    uint8_t shift = y % 8;
+    uint8_t invert = SSD1306.Inverted ? 0xFF : 0x00;
 
-    for (i = 0; i < font->height; i++)
+    for (uint8_t k = 0, page = y / 8; page < SSD1306_PAGES; k++, page++)
     {
-        for (j = 0; j < font->bytes; j++)
+        uint8_t m = SSD1306_PageBits(mask, k, shift);
+        uint8_t *row = SSD1306_ROW(page);
+        uint8_t first = 0xFF, last = 0;
+        int16_t col = x;
+
+        if (k * 8 >= shift + 32 || (k > 0 && (mask >> (k * 8 - shift)) == 0))
+        {
+            /* Past the last masked row */
+            break;
+        }
+        if (m == 0 || row == NULL)
         {
-            b = font->data[((ch - 32) * font->height + i) * font->bytes + j];
-            if (font->order == 0)
+            continue;
+        }
+        /* All runs of the page in one pass, a run is rewritten and marked
+         * only if any of its bytes changes */
+        for (uint8_t r = 0; r < count; r++)
+        {
+            uint8_t v = (SSD1306_PageBits(runs[r].bits, k, shift) ^ invert) & m;
+            int16_t end = col + runs[r].width;
+            if (col < 0)
+            {
+                col = end < 0 ? end : 0;
+            }
+            if (end > SSD1306_WIDTH)
+            {
+                end = SSD1306_WIDTH;
+            }
+            if (col < end)
             {
-                for (k = 0; k < 8 && k < font->width - j * 8; k++)
+                uint8_t diff = 0;
+                for (int16_t i = col; i < end; i++)
                 {
-                    if ((b << k) & 0x80)
+                    diff |= (row[i] & m) ^ v;
+                }
+                if (diff)
+                {
+                    if (m == 0xFF)
                     {
-                        SSD1306_DrawPixel(SSD1306.CurrentX + (j * 8) + k, (SSD1306.CurrentY + i), (uint8_t) color);
+                        memset(&row[col], v, end - col);
                     }
                     else
                     {
-                        SSD1306_DrawPixel(SSD1306.CurrentX + (j * 8) + k, (SSD1306.CurrentY + i), (uint8_t) !color);
+                        for (int16_t i = col; i < end; i++)
+                        {
+                            row[i] = (row[i] & ~m) | v;
+                        }
+                    }
+                    if (first == 0xFF)
+                    {
+                        first = col;
                     }
+                    last = end - 1;
                 }
+                col = end;
             }
-            else
+            if (end == SSD1306_WIDTH)
             {
-                for (k = 0; k < 8 && k < font->width - j * 8; k++)
+                break;
+            }
+        }
+        if (first != 0xFF)
+        {
+            SSD1306_MarkDirty(page, first, last);
+        }
+    }
+}
+
+void SSD1306_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color)
+{
+    /* Clip */
+    if (x < 0)
+    {
+        w += x;
+        x = 0;
+    }
+    if (y < 0)
+    {
+        h += y;
+        y = 0;
+    }
+    if (x + w > SSD1306_WIDTH)
+    {
+        w = SSD1306_WIDTH - x;
+    }
+    if (y + h > SSD1306_HEIGHT)
+    {
+        h = SSD1306_HEIGHT - y;
+    }
+    if (w <= 0 || h <= 0)
+    {
+        return;
+    }
+
+    /* Check if pixels are inverted */
+    if (SSD1306.Inverted && color != SSD1306_COLOR_INVERT)
+    {
+        color = (uint8_t)!color;
+    }
+
+    /* One masked span per page, the rows of the rectangle within it */
+    uint8_t page = y / 8, lastPage = (y + h - 1) / 8;
+    uint8_t mask = 0xFF << (y % 8);
+    for (; page <= lastPage; page++)
+    {
+        if (page == lastPage)
+        {
+            mask &= 0xFF >> (7 - (y + h - 1) % 8);
+        }
+        SSD1306_FillSpan(page, x, x + w - 1, mask, color);
+        mask = 0xFF;
+    }
+}
+
+void SSD1306_DrawHLine(int16_t x, int16_t y, int16_t w, uint8_t color)
+{
+    SSD1306_FillRect(x, y, w, 1, color);
+}
+
+void SSD1306_DrawVLine(int16_t x, int16_t y, int16_t h, uint8_t color)
+{
+    SSD1306_FillRect(x, y, 1, h, color);
+}
+
+void SSD1306_DrawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint8_t color)
+{
+    SSD1306_DrawHLine(x, y, w, color);
+    SSD1306_DrawHLine(x, y + h - 1, w, color);
+    SSD1306_DrawVLine(x, y + 1, h - 2, color);
+    SSD1306_DrawVLine(x + w - 1, y + 1, h - 2, color);
+}
+
+void SSD1306_DrawBar(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t value, uint16_t max)
+{
+    /* Outline, then the inside split into a filled and an empty part */
+    int16_t inner = w - 2;
+    int16_t fill = (max == 0 || value >= max) ? inner : (int32_t)inner * value / max;
+
+    SSD1306_DrawRect(x, y, w, h, SSD1306_COLOR_WHITE);
+    SSD1306_FillRect(x + 1, y + 1, fill, h - 2, SSD1306_COLOR_WHITE);
+    SSD1306_FillRect(x + 1 + fill, y + 1, inner - fill, h - 2, SSD1306_COLOR_BLACK);
+}
+
+char SSD1306_Putc(char ch, FontDef_t* font, uint8_t color)
+{
+    uint32_t i, j, k, b;
+    const uint8_t *glyph = &font->data[(ch - 32) * font->height * font->bytes];
+    uint32_t mask = font->height >= 32 ? 0xFFFFFFFF : (1UL << font->height) - 1;
+
+    /* Check if pixels are inverted */
+    if (SSD1306.Inverted)
+    {
+        color = (uint8_t)!color;
+    }
+
+    if (SSD1306.CurrentY < SSD1306_HEIGHT)
+    {
+        /* Transpose the row-major glyph one column at a time and write whole
+         * bytes per page, background pixels included */
+        for (k = 0; k < font->width; k++)
+        {
+            const uint8_t *row = &glyph[k / 8];
+            uint32_t bit = font->order == 0 ? 0x80 >> (k % 8) : 0x01 << (k % 8);
+            uint32_t column = 0;
+
+            for (i = 0, j = 1; i < font->height; i++, j <<= 1)
+            {
+                b = *row;
+                if (b & bit)
                 {
-                    if (b & (0x0001 << k))
-                    {
-                        SSD1306_DrawPixel(SSD1306.CurrentX + (j * 8) + k, (SSD1306.CurrentY + i), (uint8_t) color);
-                    }
-                    else
-                    {
-                        SSD1306_DrawPixel(SSD1306.CurrentX + (j * 8) + k, (SSD1306.CurrentY + i), (uint8_t) !color);
-                    }
+                    column |= j;
                 }
+                row += font->bytes;
             }
+            if (color != SSD1306_COLOR_WHITE)
+            {
+                column = ~column;
+            }
+            SSD1306_BlitColumn(SSD1306.CurrentX + k, SSD1306.CurrentY, column, mask);
         }
     }
 
@@ -208,9 +833,161 @@ char SSD1306_Puts(char* str, FontDef_t* Font, uint8_t color)
     return *str;
 }
 
+/* Decodes len bytes of a PAGEFONT_RLE glyph, see Tools/fontgen.py */
+static void SSD1306_Unpack(const uint8_t *src, uint8_t *dst, uint16_t len)
+{
+    uint8_t *end = dst + len;
+
+    while (dst < end)
+    {
+        uint8_t n = *src++;
+        if (n & 0x80)
+        {
+            /* Repeated byte */
+            n = n - 0x80 + 2;
+            memset(dst, *src++, n);
+        }
+        else
+        {
+            /* Literal bytes */
+            n = n + 1;
+            memcpy(dst, src, n);
+            src += n;
+        }
+        dst += n;
+    }
+}
+
+char SSD1306_PutcPaged(char ch, const PageFontDef_t* font, uint8_t color)
+{
+    const char *found = memchr(font->chars, ch, font->count);
+    uint8_t index, width, k, p;
+    const uint8_t *glyph;
+    uint8_t unpacked[PAGEFONT_MAX_GLYPH];
+
+    if (found == NULL)
+    {
+        /* Not in this font or its subset */
+        return 0;
+    }
+    index = found - font->chars;
+    width = font->width[index];
+    glyph = &font->data[font->offset[index]];
+    if (font->flags & PAGEFONT_RLE)
+    {
+        SSD1306_Unpack(glyph, unpacked, width * font->pages);
+        glyph = unpacked;
+    }
+
+    /* Check if pixels are inverted */
+    if (SSD1306.Inverted)
+    {
+        color = (uint8_t)!color;
+    }
+
+    if (SSD1306.CurrentY < SSD1306_HEIGHT)
+    {
+        if (SSD1306.CurrentY % 8 == 0 && SSD1306.CurrentX + width <= SSD1306_WIDTH)
+        {
+            /* Page-aligned: the glyph rows are already framebuffer bytes */
+            uint8_t x = SSD1306.CurrentX;
+            uint8_t page = SSD1306.CurrentY / 8;
+            uint8_t invert = (color == SSD1306_COLOR_WHITE) ? 0x00 : 0xFF;
+
+            for (p = 0; p < font->pages && page < SSD1306_PAGES; p++, page++)
+            {
+                const uint8_t *src = &glyph[p * width];
+                uint8_t *dst = SSD1306_ROW(page);
+                uint8_t rows = font->height - p * 8;
+                uint8_t mask = rows >= 8 ? 0xFF : (1 << rows) - 1;
+
+                if (dst == NULL)
+                {
+                    continue;
+                }
+                dst += x;
+                if (mask == 0xFF && !invert)
+                {
+                    if (memcmp(dst, src, width) != 0)
+                    {
+                        memcpy(dst, src, width);
+                        SSD1306_MarkDirty(page, x, x + width - 1);
+                    }
+                    continue;
+                }
+                for (k = 0; k < width; k++)
+                {
+                    uint8_t value = (dst[k] & ~mask) | ((src[k] ^ invert) & mask);
+                    if (value != dst[k])
+                    {
+                        dst[k] = value;
+                        SSD1306_MarkDirty(page, x + k, x + k);
+                    }
+                }
+            }
+        }
+        else
+        {
+            uint32_t mask = font->height >= 32 ? 0xFFFFFFFF : (1UL << font->height) - 1;
+            for (k = 0; k < width; k++)
+            {
+                uint32_t column = 0;
+                for (p = 0; p < font->pages; p++)
+                {
+                    column |= (uint32_t)glyph[p * width + k] << (p * 8);
+                }
+                if (color != SSD1306_COLOR_WHITE)
+                {
+                    column = ~column;
+                }
+                SSD1306_BlitColumn(SSD1306.CurrentX + k, SSD1306.CurrentY, column, mask);
+            }
+        }
+    }
+
+    /* Increase pointer */
+    SSD1306.CurrentX += width;
+
+    /* Return character written */
+    return ch;
+}
+
+char SSD1306_PutsPaged(const char* str, const PageFontDef_t* font, uint8_t color)
+{
+    /* Write characters */
+    while (*str)
+    {
+        if (SSD1306_PutcPaged(*str, font, color) != *str)
+        {
+            /* Return error */
+            return *str;
+        }
+        str++;
+    }
+
+    /* Everything OK, zero should be returned */
+    return *str;
+}
+
+uint16_t SSD1306_TextWidthPaged(const char* str, const PageFontDef_t* font)
+{
+    uint16_t width = 0;
+
+    /* Sum of the advances, characters missing from the font take none */
+    for (; *str; str++)
+    {
+        const char *found = memchr(font->chars, *str, font->count);
+        if (found != NULL)
+        {
+            width += font->width[found - font->chars];
+        }
+    }
+    return width;
+}
+
 void SSD1306_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t c)
 {
-    int16_t dx, dy, sx, sy, err, e2, i, tmp; 
+    int16_t dx, dy, sx, sy, err, e2;
     
     /* Check for overflow */
     if (x0 >= SSD1306_WIDTH)
@@ -236,58 +1013,15 @@ void SSD1306_DrawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_
     sy = (y0 < y1) ? 1 : -1; 
     err = ((dx > dy) ? dx : -dy) / 2; 
 
-    if (dx == 0)
+    if (dx == 0 || dy == 0)
     {
-        if (y1 < y0)
-        {
-            tmp = y1;
-            y1 = y0;
-            y0 = tmp;
-        }
-        
-        if (x1 < x0)
-        {
-            tmp = x1;
-            x1 = x0;
-            x0 = tmp;
-        }
-        
-        /* Vertical line */
-        for (i = y0; i <= y1; i++)
-        {
-            SSD1306_DrawPixel(x0, i, c);
-        }
-        
-        /* Return from function */
-        return;
-    }
-    
-    if (dy == 0)
-    {
-        if (y1 < y0)
-        {
-            tmp = y1;
-            y1 = y0;
-            y0 = tmp;
-        }
-        
-        if (x1 < x0)
-        {
-            tmp = x1;
-            x1 = x0;
-            x0 = tmp;
-        }
-        
-        /* Horizontal line */
-        for (i = x0; i <= x1; i++)
-        {
-            SSD1306_DrawPixel(i, y0, c);
-        }
-        
-        /* Return from function */
+        /* Horizontal or vertical line, one span per page */
+        SSD1306_FillRect(x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, dx + 1, dy + 1, c);
         return;
     }
 
+    /* Sloped lines stay per pixel, their runs are too short for spans to
+     * pay off */
     while (1)
     {
         SSD1306_DrawPixel(x0, y0, c);
@@ -350,16 +1084,20 @@ void SSD1306_Image(uint8_t *img, uint8_t frame, uint8_t x, uint8_t y)
 {
     uint32_t i, b, j;
 
-    b = 0;
     if(frame >= img[2])
         return;
-    uint32_t start = (frame * (img[3] + (img[4] << 8)));
-    
-    /* Go through font */
-    for (i = 0; i < img[1]; i++) {
-        for (j = 0; j < img[0]; j++) {
-            SSD1306_DrawPixel(x + j, (y + i), (uint8_t) (img[b/8 + 5 + start] >> (b%8)) & 1);
-            b++;
+    const uint8_t *bits = &img[5 + frame * (img[3] + (img[4] << 8))];
+
+    /* Gather each column into a word and write it a page at a time */
+    for (j = 0; j < img[0]; j++) {
+        for (i = 0; i < img[1]; i += 32) {
+            uint8_t rows = img[1] - i > 32 ? 32 : img[1] - i;
+            uint32_t column = 0;
+            for (uint8_t k = 0; k < rows; k++) {
+                b = (i + k) * img[0] + j;
+                column |= (uint32_t)((bits[b / 8] >> (b % 8)) & 1) << k;
+            }
+            SSD1306_DrawColumn(x + j, y + i, column, rows >= 32 ? 0xFFFFFFFF : (1UL << rows) - 1);
         }
     }
 }
@@ -0,0 +1,130 @@
+#include "telem.h"
+
+// CRC of one nibble, half the flash of a byte table and two lookups per byte
+static const uint16_t TELEM_CrcTable[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t TELEM_Crc16(uint16_t crc, const uint8_t *data, uint16_t len) {
+  while (len--) {
+    uint8_t byte = *data++;
+    crc = (crc << 4) ^ TELEM_CrcTable[(crc >> 12) ^ (byte >> 4)];
+    crc = (crc << 4) ^ TELEM_CrcTable[(crc >> 12) ^ (byte & 0x0F)];
+  }
+  return crc;
+}
+
+uint16_t TELEM_CobsEncode(uint8_t *out, const uint8_t *in, uint16_t len) {
+  // Every zero is replaced by the distance to the next one, the code byte
+  // of each block is filled in once the block ends
+  uint8_t *code = out;
+  uint8_t *p = out + 1;
+  uint8_t run = 1;
+  for (uint16_t i = 0; i < len; i++) {
+    if (in[i] != 0) {
+      *p++ = in[i];
+      run++;
+    }
+    if (in[i] == 0 || run == 0xFF) {
+      *code = run;
+      code = p++;
+      run = 1;
+    }
+  }
+  *code = run;
+  *p++ = 0;
+  return p - out;
+}
+
+uint8_t TELEM_EncodeSample(uint8_t *frame, const TELEM_Sample *sample) {
+  uint8_t record[TELEM_RECORD_SIZE];
+  record[0] = TELEM_VERSION;
+  record[1] = sample->sequence;
+  record[2] = sample->time;
+  record[3] = sample->time >> 8;
+  record[4] = sample->time >> 16;
+  record[5] = sample->time >> 24;
+  record[6] = (uint16_t)sample->shunt;
+  record[7] = (uint16_t)sample->shunt >> 8;
+  record[8] = sample->bus;
+  record[9] = sample->bus >> 8;
+  record[10] = sample->flags;
+  uint16_t crc = TELEM_Crc16(0xFFFF, record, TELEM_RECORD_SIZE - 2);
+  record[11] = crc;
+  record[12] = crc >> 8;
+  return TELEM_CobsEncode(frame, record, TELEM_RECORD_SIZE);
+}
+
+// Largest delta: a 5 byte interval, two 3 byte values and the flags
+#define TELEM_DELTA_MAX 12
+
+static uint32_t TELEM_ZigZag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static uint8_t *TELEM_Varint(uint8_t *p, uint32_t value) {
+  while (value >= 0x80) {
+    *p++ = value | 0x80;
+    value >>= 7;
+  }
+  *p++ = value;
+  return p;
+}
+
+void TELEM_InitBlock(TELEM_Block *block) { block->count = 0; }
+
+uint8_t TELEM_AddSample(TELEM_Block *block, const TELEM_Sample *sample,
+                        uint32_t next) {
+  uint8_t *p = block->data;
+  if (block->count == 0) {
+    // Keyframe
+    p[0] = TELEM_KIND_BLOCK;
+    p[1] = sample->sequence;
+    p[3] = sample->time;
+    p[4] = sample->time >> 8;
+    p[5] = sample->time >> 16;
+    p[6] = sample->time >> 24;
+    p[7] = (uint16_t)sample->shunt;
+    p[8] = (uint16_t)sample->shunt >> 8;
+    p[9] = sample->bus;
+    p[10] = sample->bus >> 8;
+    p[11] = sample->flags;
+    block->len = 12;
+    block->interval = 0;
+    block->start = sample->time;
+  } else {
+    uint32_t interval = sample->time - block->last.time;
+    uint8_t newFlags = sample->flags != block->last.flags;
+    p = TELEM_Varint(p + block->len,
+                     TELEM_ZigZag((int32_t)(interval - block->interval)));
+    p = TELEM_Varint(
+        p, TELEM_ZigZag(sample->shunt - block->last.shunt) << 1 | newFlags);
+    p = TELEM_Varint(p, TELEM_ZigZag(sample->bus - block->last.bus));
+    if (newFlags) {
+      *p++ = sample->flags;
+    }
+    block->len = p - block->data;
+    block->interval = interval;
+  }
+  block->last = *sample;
+  block->count++;
+  return block->count == TELEM_BLOCK_SAMPLES ||
+         block->len + TELEM_DELTA_MAX > TELEM_BLOCK_SIZE ||
+         sample->time - block->start + next > TELEM_BLOCK_TIME;
+}
+
+uint8_t TELEM_EncodeBlock(uint8_t *frame, TELEM_Block *block) {
+  if (block->count == 0) {
+    return 0;
+  }
+  // The CRC goes in place behind the deltas
+  uint8_t *record = block->data;
+  uint8_t len = block->len;
+  record[2] = block->count;
+  uint16_t crc = TELEM_Crc16(0xFFFF, record, len);
+  record[len] = crc;
+  record[len + 1] = crc >> 8;
+  block->count = 0;
+  return TELEM_CobsEncode(frame, record, len + 2);
+}
@@ -0,0 +1,145 @@
+#include "uart.h"
+
+#include <string.h>
+
+static uint8_t UART_Buffer[UART_TX_SIZE];
+// Free-running indices, masked on access: head is only written by the
+// writers, tail only by the interrupt
+static volatile uint16_t UART_Head;
+static volatile uint16_t UART_Tail;
+static uint8_t UART_Held;
+static UART_Stats UART_Cost;
+// Received bytes, the interrupt is the producer here
+static uint8_t UART_RxBuffer[UART_RX_SIZE];
+static volatile uint8_t UART_RxHead;
+static volatile uint8_t UART_RxTail;
+
+void UART_Init(uint32_t baud) {
+  LL_GPIO_InitTypeDef gpio = {0};
+  LL_IOP_GRP1_EnableClock(LL_IOP_GRP1_PERIPH_GPIOA);
+  LL_APB1_GRP2_EnableClock(LL_APB1_GRP2_PERIPH_USART1);
+
+  gpio.Pin = LL_GPIO_PIN_2 | LL_GPIO_PIN_3;
+  gpio.Mode = LL_GPIO_MODE_ALTERNATE;
+  gpio.Speed = LL_GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.OutputType = LL_GPIO_OUTPUT_PUSHPULL;
+  gpio.Pull = LL_GPIO_PULL_UP;
+  gpio.Alternate = LL_GPIO_AF_1;
+  LL_GPIO_Init(GPIOA, &gpio);
+
+  LL_USART_SetBaudRate(USART1, SystemCoreClock, LL_USART_OVERSAMPLING_16,
+                       UART_ActualBaud(baud));
+  LL_USART_SetDataWidth(USART1, LL_USART_DATAWIDTH_8B);
+  LL_USART_SetStopBitsLength(USART1, LL_USART_STOPBITS_1);
+  LL_USART_SetParity(USART1, LL_USART_PARITY_NONE);
+  LL_USART_SetHWFlowCtrl(USART1, LL_USART_HWCONTROL_NONE);
+  LL_USART_SetTransferDirection(USART1, LL_USART_DIRECTION_TX_RX);
+  LL_USART_Enable(USART1);
+  LL_USART_EnableIT_RXNE(USART1);
+
+  // Below SysTick, a late byte only stretches the gap on the wire
+  NVIC_SetPriority(USART1_IRQn, 2);
+  NVIC_EnableIRQ(USART1_IRQn);
+}
+
+uint16_t UART_Write(const void *data, uint16_t len) {
+  uint16_t head = UART_Head;
+  uint16_t used = head - UART_Tail;
+  if (UART_Held || len > UART_TX_SIZE - used) {
+    UART_Cost.dropped += len;
+    return 0;
+  }
+  // Copy in at most two pieces around the end of the buffer
+  uint16_t at = head & (UART_TX_SIZE - 1);
+  uint16_t first = UART_TX_SIZE - at;
+  if (first > len) {
+    first = len;
+  }
+  memcpy(&UART_Buffer[at], data, first);
+  memcpy(UART_Buffer, (const uint8_t *)data + first, len - first);
+  // Publish the bytes only once they are in place
+  UART_Head = head + len;
+  LL_USART_EnableIT_TXE(USART1);
+
+  UART_Cost.queued += len;
+  if (used + len > UART_Cost.peak) {
+    UART_Cost.peak = used + len;
+  }
+  return len;
+}
+
+uint8_t UART_Read(uint8_t *byte) {
+  uint8_t tail = UART_RxTail;
+  if (tail == UART_RxHead) {
+    return 0;
+  }
+  *byte = UART_RxBuffer[tail % UART_RX_SIZE];
+  UART_RxTail = tail + 1;
+  return 1;
+}
+
+uint8_t UART_Idle(void) {
+  return UART_Head == UART_Tail && LL_USART_IsActiveFlag_TC(USART1);
+}
+
+void UART_Hold(uint8_t hold) { UART_Held = hold; }
+
+uint32_t UART_ActualBaud(uint32_t baud) {
+  // BRR holds clock / rate with 4 fractional bits of the /16 divider,
+  // rounded to the nearest, and is 16 bits wide
+  if (baud == 0 || baud > UART_MAX_BAUD(SystemCoreClock)) {
+    return 0;
+  }
+  uint32_t divider = (SystemCoreClock + baud / 2) / baud;
+  if (divider > 0xFFFF) {
+    return 0;
+  }
+  return (SystemCoreClock + divider / 2) / divider;
+}
+
+uint32_t UART_SetBaud(uint32_t baud) {
+  uint32_t actual = UART_ActualBaud(baud);
+  if (actual) {
+    LL_USART_Disable(USART1);
+    LL_USART_SetBaudRate(USART1, SystemCoreClock, LL_USART_OVERSAMPLING_16,
+                         actual);
+    LL_USART_Enable(USART1);
+  }
+  return actual;
+}
+
+const UART_Stats *UART_GetStats(void) { return &UART_Cost; }
+
+void UART_IRQHandler(void) {
+  if (LL_USART_IsActiveFlag_RXNE(USART1)) {
+    uint8_t byte = LL_USART_ReceiveData8(USART1);
+    uint8_t head = UART_RxHead;
+    if ((uint8_t)(head - UART_RxTail) < UART_RX_SIZE) {
+      UART_RxBuffer[head % UART_RX_SIZE] = byte;
+      UART_RxHead = head + 1;
+    } else {
+      UART_Cost.overrun++;
+    }
+  }
+  if (LL_USART_IsActiveFlag_ORE(USART1)) {
+    LL_USART_ClearFlag_ORE(USART1);
+    UART_Cost.overrun++;
+  }
+  if (LL_USART_IsEnabledIT_TXE(USART1) && LL_USART_IsActiveFlag_TXE(USART1)) {
+    uint16_t tail = UART_Tail;
+    if (tail == UART_Head) {
+      // Drained, the next write enables the interrupt again
+      LL_USART_DisableIT_TXE(USART1);
+    } else {
+      LL_USART_TransmitData8(USART1, UART_Buffer[tail & (UART_TX_SIZE - 1)]);
+      UART_Tail = tail + 1;
+    }
+  }
+}
+
+// newlib output of printf and putchar
+int _write(int file, char *ptr, int len) {
+  (void)file;
+  UART_Write(ptr, len);
+  return len;
+}
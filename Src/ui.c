@@ -0,0 +1,233 @@
+#include "ui.h"
+
+static UI_Stats UI_Cost;
+static uint8_t UI_Sending;
+static const UI_Item *UI_Screen;
+static uint8_t UI_ScreenSize;
+#ifdef SSD1306_PAGE_MODE
+static uint8_t UI_Changed;
+static uint8_t UI_Page; // next page to render
+#endif
+
+#ifndef SSD1306_PAGE_MODE
+static uint8_t UI_GlyphWidth(const PageFontDef_t *font, char ch) {
+  const char *found = memchr(font->chars, ch, font->count);
+  return found ? font->width[found - font->chars] : 0;
+}
+#endif
+
+void UI_Init(void) {
+  memset(&UI_Cost, 0, sizeof(UI_Cost));
+  UI_Sending = 0;
+}
+
+void UI_InitField(UI_Field *field, uint8_t x, uint8_t y,
+                  const PageFontDef_t *font) {
+  memset(field, 0, sizeof(*field));
+  field->font = font;
+  field->x = x;
+  field->y = y;
+  field->start = x;
+  field->end = x;
+}
+
+void UI_InitFieldRight(UI_Field *field, uint8_t right, uint8_t y,
+                       const PageFontDef_t *font) {
+  UI_InitField(field, right, y, font);
+  field->align = UI_ALIGN_RIGHT;
+}
+
+// Column the text starts at
+static uint8_t UI_TextStart(const UI_Field *field, const char *text) {
+  if (field->align != UI_ALIGN_RIGHT) {
+    return field->x;
+  }
+  uint16_t width = SSD1306_TextWidthPaged(text, field->font);
+  return width < field->x ? field->x - width : 0;
+}
+
+static void UI_DrawScreen(void) {
+  for (uint8_t i = 0; i < UI_ScreenSize; i++) {
+    UI_Screen[i].draw(UI_Screen[i].object);
+  }
+}
+
+void UI_SetScreen(const UI_Item *items, uint8_t count) {
+  UI_Screen = items;
+  UI_ScreenSize = count;
+#ifdef SSD1306_PAGE_MODE
+  UI_Changed = 1;
+#else
+  SSD1306_Fill(SSD1306_COLOR_BLACK);
+  UI_DrawScreen();
+#endif
+}
+
+void UI_DrawField(void *object) {
+  UI_Field *field = object;
+  SSD1306_GotoXY(UI_TextStart(field, field->text), field->y);
+  for (const char *c = field->text; *c; c++) {
+    SSD1306_PutcPaged(*c, field->font, SSD1306_COLOR_WHITE);
+  }
+}
+
+void UI_Refresh(void) {
+#ifdef SSD1306_PAGE_MODE
+  UI_Changed = 1;
+#endif
+}
+
+#ifdef SSD1306_PAGE_MODE
+uint8_t UI_SetText(UI_Field *field, const char *text) {
+  uint8_t changed = 0;
+  uint8_t i;
+  // Only remember the text, the next frame renders it from the screen list
+  for (i = 0; i < UI_FIELD_LEN && text[i]; i++) {
+    if (field->text[i] != text[i]) {
+      field->text[i] = text[i];
+      changed++;
+    }
+  }
+  if (field->text[i] != '\0') {
+    field->text[i] = '\0';
+    changed++;
+  }
+  if (changed) {
+    UI_Changed = 1;
+  }
+  return changed;
+}
+#else
+uint8_t UI_SetText(UI_Field *field, const char *text) {
+  const PageFontDef_t *font = field->font;
+  uint32_t time = APP_GetMicros();
+  uint8_t drawn = 0;
+  uint8_t reused = 0;
+  uint8_t start = field->x;
+  if (field->align == UI_ALIGN_RIGHT) {
+    char clipped[UI_FIELD_LEN + 1];
+    strncpy(clipped, text, UI_FIELD_LEN);
+    clipped[UI_FIELD_LEN] = '\0';
+    start = UI_TextStart(field, clipped);
+  }
+  // Glyphs stay in place as long as the text starts where it did and every
+  // glyph before them kept its width, which is always the case with
+  // monospaced fonts and for the digits of tabular ones
+  uint8_t aligned = start == field->start;
+  uint8_t x = start;
+  uint8_t i;
+
+  for (i = 0; i < UI_FIELD_LEN && text[i]; i++) {
+    char old = aligned ? field->text[i] : '\0';
+    uint8_t width = UI_GlyphWidth(font, text[i]);
+    if (old == text[i]) {
+      reused++;
+    } else {
+      if (old == '\0' || UI_GlyphWidth(font, old) != width) {
+        aligned = 0;
+      }
+      SSD1306_GotoXY(x, field->y);
+      SSD1306_PutcPaged(text[i], font, SSD1306_COLOR_WHITE);
+      drawn++;
+    }
+    field->text[i] = text[i];
+    x += width;
+  }
+  field->text[i] = '\0';
+
+  // Clear what is left of a longer previous text, on either side
+  if (start > field->start) {
+    SSD1306_FillRect(field->start, field->y, start - field->start,
+                     font->height, SSD1306_COLOR_BLACK);
+  }
+  if (x < field->end) {
+    SSD1306_FillRect(x, field->y, field->end - x, font->height,
+                     SSD1306_COLOR_BLACK);
+  }
+  field->start = start;
+  field->end = x;
+
+  UI_Cost.glyphs += drawn;
+  UI_Cost.reused += reused;
+  UI_Cost.time += APP_GetMicros() - time;
+  return drawn;
+}
+#endif
+
+#ifdef SSD1306_PAGE_MODE
+uint8_t UI_Flush(void) {
+  if (UI_Sending) {
+    UI_Cost.deferred++;
+    return 0;
+  }
+  if (!UI_Changed) {
+    UI_Cost.skipped++;
+    return 0;
+  }
+  UI_Changed = 0;
+  UI_Page = 0;
+  UI_Sending = 1;
+  UI_Cost.frames++;
+  return 1;
+}
+
+uint8_t UI_Poll(void) {
+  if (!UI_Sending) {
+    return 0;
+  }
+  uint32_t start = APP_GetMicros();
+  if (!SSD1306_Poll()) {
+    // Previous page is out, render the next one into the page buffer
+    if (UI_Page > 0) {
+      UI_Cost.bytes += SSD1306_GetFrameBytes();
+    }
+    if (UI_Page == SSD1306_HEIGHT / 8) {
+      UI_Sending = 0;
+    } else {
+      SSD1306_BeginPage(UI_Page++);
+      UI_DrawScreen();
+      SSD1306_Present();
+    }
+  }
+  uint32_t time = APP_GetMicros() - start;
+  UI_Cost.time += time;
+  if (time > UI_Cost.maxPoll) {
+    UI_Cost.maxPoll = time;
+  }
+  return UI_Sending;
+}
+#else
+uint8_t UI_Flush(void) {
+  switch (SSD1306_Present()) {
+  case SSD1306_PRESENT_QUEUED:
+    UI_Cost.frames++;
+    UI_Sending = 1;
+    return 1;
+  case SSD1306_PRESENT_BUSY:
+    UI_Cost.deferred++;
+    return 0;
+  default:
+    UI_Cost.skipped++;
+    return 0;
+  }
+}
+
+uint8_t UI_Poll(void) {
+  if (!UI_Sending) {
+    return 0;
+  }
+  uint32_t start = APP_GetMicros();
+  UI_Sending = SSD1306_Poll();
+  uint32_t time = APP_GetMicros() - start;
+  UI_Cost.time += time;
+  if (time > UI_Cost.maxPoll) {
+    UI_Cost.maxPoll = time;
+  }
+  if (!UI_Sending) {
+    UI_Cost.bytes += SSD1306_GetFrameBytes();
+  }
+  return UI_Sending;
+}
+#endif
+
+const UI_Stats *UI_GetStats(void) { return &UI_Cost; }
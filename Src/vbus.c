@@ -0,0 +1,97 @@
+#include "vbus.h"
+#include <stddef.h>
+#include <string.h>
+
+// Samples inside the settle band, in addition to VBUS_SETTLE_TIME
+#define VBUS_SETTLE_SAMPLES 3
+
+void VBUS_Init(VBUS_Log *log) { memset(log, 0, sizeof(*log)); }
+
+static void VBUS_Append(VBUS_Log *log, int32_t from, int32_t to) {
+  VBUS_Event *event = &log->events[log->head];
+  event->time = log->ms - (log->lastTime - log->start) / 1000;
+  event->rise = log->enter - log->start;
+  event->from = from;
+  event->to = to;
+  int32_t overshoot = to > from ? log->max - to : to - log->min;
+  event->overshoot = overshoot > 0 ? overshoot : 0;
+  log->head = (log->head + 1) % VBUS_LOG_SIZE;
+  if (log->count < VBUS_LOG_SIZE) {
+    log->count++;
+  }
+}
+
+uint8_t VBUS_Update(VBUS_Log *log, uint32_t time, int32_t voltage) {
+  if (!log->started) {
+    log->level = voltage << 3;
+    log->lastTime = time;
+    log->started = 1;
+    return 0;
+  }
+
+  log->us += time - log->lastTime;
+  log->ms += log->us / 1000;
+  log->us %= 1000;
+
+  uint8_t events = 0;
+  if (!log->moving) {
+    int32_t deviation = voltage - (log->level >> 3);
+    if (deviation > VBUS_STEP_THRESHOLD || deviation < -VBUS_STEP_THRESHOLD) {
+      log->moving = 1;
+      log->start = log->lastTime;
+      log->max = log->min = voltage;
+      log->anchor = voltage;
+      log->enter = time;
+      log->settled = 1;
+      log->settleSum = voltage;
+      events |= VBUS_EVENT_START;
+    } else {
+      // Follow slow drift of the stable level
+      log->level += ((voltage << 3) - log->level) >> 3;
+    }
+    log->lastTime = time;
+    return events;
+  }
+
+  if (voltage > log->max) {
+    log->max = voltage;
+  }
+  if (voltage < log->min) {
+    log->min = voltage;
+  }
+  int32_t deviation = voltage - log->anchor;
+  if (deviation <= VBUS_SETTLE_BAND && deviation >= -VBUS_SETTLE_BAND) {
+    if (log->settled < 255) {
+      log->settled++;
+      log->settleSum += voltage;
+    }
+  } else {
+    // Still moving, restart the settle window here
+    log->anchor = voltage;
+    log->enter = time;
+    log->settled = 1;
+    log->settleSum = voltage;
+  }
+  log->lastTime = time;
+
+  if (log->settled >= VBUS_SETTLE_SAMPLES &&
+      time - log->enter >= VBUS_SETTLE_TIME) {
+    int32_t from = log->level >> 3;
+    int32_t to = log->settleSum / log->settled;
+    log->moving = 0;
+    log->level = to << 3;
+    // A dip that returned to the old level is not a level change
+    if (to - from >= VBUS_STEP_THRESHOLD || from - to >= VBUS_STEP_THRESHOLD) {
+      VBUS_Append(log, from, to);
+      events |= VBUS_EVENT_LOGGED;
+    }
+  }
+  return events;
+}
+
+const VBUS_Event *VBUS_GetEvent(const VBUS_Log *log, uint8_t n) {
+  if (n >= log->count) {
+    return NULL;
+  }
+  return &log->events[(log->head + VBUS_LOG_SIZE - 1 - n) % VBUS_LOG_SIZE];
+}
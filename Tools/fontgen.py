@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""Compiles the row-major fonts of Src/ascii_fonts.c into the SSD1306 native
+layout: vertical bytes, LSB at the top, one run of `width` bytes per 8-pixel
+page. Each glyph gets its own offset and advance width, so fonts can be
+proportional and can hold any subset of the ASCII characters.
+
+Usage: fontgen.py --source Src/ascii_fonts.c --output DIR SPEC...
+
+SPEC is <font>:<mono|prop|tab>[+rle]:<characters>, e.g. Font_11x18:tab+rle:0123.
+mono keeps the cell width, prop trims every glyph to its ink plus one column
+of spacing, and tab does the same except for the digits, which all get the
+width of the widest digit so numbers do not shift as they change. An empty
+character list selects all 95 printable ASCII characters. +rle
+compresses every glyph with a byte-level run-length code, decoded by
+SSD1306_PutcPaged:
+  0x00-0x7F  n + 1 literal bytes follow
+  0x80-0xFF  the next byte repeats n - 0x80 + 2 times
+"""
+
+import argparse
+import os
+import re
+import sys
+
+FIRST_CHAR = 32
+NUM_CHARS = 95
+# Flags of PageFontDef_t, keep in sync with ascii_fonts.h
+PAGEFONT_RLE = 0x01
+# Largest glyph SSD1306_PutcPaged can unpack, PAGEFONT_MAX_GLYPH
+MAX_GLYPH = 64
+
+
+class Font:
+    def __init__(self, name, width, height, order, nbytes, data):
+        self.name = name
+        self.width = width
+        self.height = height
+        self.order = order
+        self.bytes = nbytes
+        self.data = data
+
+    def pixel(self, ch, x, y):
+        index = ((ord(ch) - FIRST_CHAR) * self.height + y) * self.bytes + x // 8
+        b = self.data[index]
+        if self.order == 0:
+            return (b << (x % 8)) & 0x80 != 0
+        return b & (1 << (x % 8)) != 0
+
+    def column(self, ch, x):
+        bits = 0
+        for y in range(self.height):
+            if self.pixel(ch, x, y):
+                bits |= 1 << y
+        return bits
+
+
+def parse_fonts(path):
+    """Returns {font name: Font} for every FontDef_t in ascii_fonts.c."""
+    tables = {}
+    name = None
+    with open(path) as f:
+        for line in f:
+            m = re.match(r"static const uint8_t (\w+)\s*\[\]\s*=\s*\{", line)
+            if m:
+                name = m.group(1)
+                tables[name] = []
+                continue
+            if name is None:
+                continue
+            if line.strip().startswith("};"):
+                name = None
+                continue
+            code = re.sub(r"/\*.*?\*/|//.*", "", line)
+            tables[name].extend(int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]+", code))
+
+    fonts = {}
+    with open(path) as f:
+        text = f.read()
+    for m in re.finditer(
+        r"FontDef_t\s+(\w+)\s*=\s*\{\s*(\d+),\s*(\d+),\s*(\d+),\s*(\d+),\s*(\w+)\s*\}", text
+    ):
+        fname, width, height, order, nbytes, table = m.groups()
+        fonts[fname] = Font(fname, int(width), int(height), int(order), int(nbytes), tables[table])
+    return fonts
+
+
+def ink_range(font, chars):
+    """Returns the first and last column holding ink in any of chars."""
+    used = [x for ch in chars for x in range(font.width) if font.column(ch, x)]
+    return (min(used), max(used)) if used else None
+
+
+def compile_glyph(font, ch, mode):
+    """Returns the glyph as a list of page rows, each a list of column bytes."""
+    columns = [font.column(ch, x) for x in range(font.width)]
+    if mode != "mono":
+        # Tabular digits share the columns used by any digit
+        used = ink_range(font, "0123456789" if mode == "tab" and ch.isdigit() else ch)
+        if used:
+            # Trim empty columns, keep one column of spacing on the right
+            columns = columns[used[0] : used[1] + 1] + [0]
+        else:
+            columns = [0] * max(1, font.width // 2)
+    pages = (font.height + 7) // 8
+    return [[(bits >> (8 * p)) & 0xFF for bits in columns] for p in range(pages)]
+
+
+def rle(data):
+    out = []
+    literal = []
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < 129:
+            run += 1
+        if run >= 3:
+            if literal:
+                out += [len(literal) - 1] + literal
+                literal = []
+            out += [0x80 + run - 2, data[i]]
+            i += run
+            continue
+        literal.append(data[i])
+        i += 1
+        if len(literal) == 128:
+            out += [len(literal) - 1] + literal
+            literal = []
+    if literal:
+        out += [len(literal) - 1] + literal
+    return out
+
+
+def c_string(chars):
+    return '"' + chars.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def generate(fonts, specs, output):
+    source = [
+        "/* Generated by Tools/fontgen.py from Src/ascii_fonts.c, do not edit */",
+        '#include "page_fonts.h"',
+        "",
+    ]
+    header = [
+        "/* Generated by Tools/fontgen.py from Src/ascii_fonts.c, do not edit */",
+        "#ifndef __PAGE_FONTS_H__",
+        "#define __PAGE_FONTS_H__",
+        "",
+        '#include "ascii_fonts.h"',
+        "",
+    ]
+    total_original = 0
+    total_size = 0
+    for spec in specs:
+        fname, mode, chars = spec.split(":", 2)
+        mode, _, packing = mode.partition("+")
+        if fname not in fonts:
+            sys.exit(f"fontgen: unknown font {fname}")
+        if mode not in ("mono", "prop", "tab") or packing not in ("", "rle"):
+            sys.exit(f"fontgen: unknown mode {mode} in {spec}")
+        font = fonts[fname]
+        if not chars:
+            chars = "".join(chr(c) for c in range(FIRST_CHAR, FIRST_CHAR + NUM_CHARS))
+        chars = "".join(dict.fromkeys(chars))
+        for ch in chars:
+            if not FIRST_CHAR <= ord(ch) < FIRST_CHAR + NUM_CHARS:
+                sys.exit(f"fontgen: {fname} has no glyph for {ch!r}")
+
+        suffix = fname[len("Font_"):] if fname.startswith("Font_") else fname
+        ident = "PageFont" + suffix
+        data, offsets, widths = [], [], []
+        flags = 0
+        for ch in chars:
+            pages = compile_glyph(font, ch, mode)
+            glyph = [b for row in pages for b in row]
+            offsets.append(len(data))
+            widths.append(len(pages[0]))
+            if packing == "rle":
+                if len(glyph) > MAX_GLYPH:
+                    sys.exit(f"fontgen: {fname} glyphs are too large for +rle")
+                flags |= PAGEFONT_RLE
+                glyph = rle(glyph)
+            data.extend(glyph)
+
+        source.append(f"static const uint8_t {ident}_Data[] = {{")
+        for i in range(0, len(data), 16):
+            source.append("    " + ", ".join(f"0x{b:02X}" for b in data[i : i + 16]) + ",")
+        source.append("};")
+        source.append(f"static const uint16_t {ident}_Offset[] = {{{', '.join(map(str, offsets))}}};")
+        source.append(f"static const uint8_t {ident}_Width[] = {{{', '.join(map(str, widths))}}};")
+        source.append(
+            f"const PageFontDef_t PageFont_{suffix} = {{{font.height}, {(font.height + 7) // 8}, "
+            f"{len(chars)}, {flags}, {c_string(chars)}, {ident}_Offset, {ident}_Width, {ident}_Data}};"
+        )
+        source.append("")
+        header.append(f"extern const PageFontDef_t PageFont_{suffix};")
+
+        # Data, offset and width tables, character list
+        size = len(data) + 3 * len(chars) + len(chars) + 1
+        original = NUM_CHARS * font.height * font.bytes
+        total_size += size
+        total_original += original
+        print(f"fontgen: PageFont_{suffix}: {len(chars)} glyphs, {spec.split(':')[1]}, "
+              f"{size} bytes ({fname}: {original} bytes)")
+    print(f"fontgen: {total_size} bytes of font data, {total_original - total_size} bytes "
+          f"saved against the full row-major fonts")
+
+    header += ["", "#endif // __PAGE_FONTS_H__", ""]
+    os.makedirs(output, exist_ok=True)
+    write_if_changed(os.path.join(output, "page_fonts.c"), "\n".join(source))
+    write_if_changed(os.path.join(output, "page_fonts.h"), "\n".join(header))
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                # Still newer than the inputs, or the build reruns the generator
+                os.utime(path)
+                return
+    with open(path, "w") as f:
+        f.write(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--source", required=True, help="path to ascii_fonts.c")
+    parser.add_argument("--output", required=True, help="output directory")
+    parser.add_argument("specs", nargs="+", metavar="SPEC")
+    args = parser.parse_args()
+    generate(parse_fonts(args.source), args.specs, args.output)
+
+
+if __name__ == "__main__":
+    main()
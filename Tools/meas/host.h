@@ -0,0 +1,10 @@
+#pragma once
+
+// Host replacement for Inc/main.h: the measurement modules only need the
+// types of the I2C configuration, not the PY32 LL headers. Included ahead of
+// every source by CMakeLists.txt, its guard keeps Inc/main.h out.
+#define __MAIN_H
+
+#include <stdint.h>
+
+typedef struct GPIO_TypeDef GPIO_TypeDef;
@@ -0,0 +1,408 @@
+// Host checks of the measurement modules. Synthetic signals with a known
+// answer are sampled at the firmware's rates and fed through the real
+// sources in Src/, the results are compared with what went in.
+//
+// Usage: meassim check  run every case, exit 1 on any mismatch
+//
+// Build with cmake -S Tools/meas -B build-meas.
+
+#include "adapt.h"
+#include "alarm.h"
+#include "period.h"
+#include "vbus.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int SIM_Failures;
+static int SIM_Cases;
+
+static void SIM_Expect(const char *name, int ok, const char *detail) {
+  SIM_Cases++;
+  if (!ok) {
+    printf("FAIL %s: %s\n", name, detail);
+    SIM_Failures++;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Periodic-load detector
+
+typedef struct SIM_Wave {
+  const char *name;
+  char shape;       // 's'ine or s'q'uare
+  uint32_t period;  // us
+  uint16_t duty;    // permille, square only
+  int32_t low;      // mA, square: idle current, sine: mean - amplitude
+  int32_t high;     // mA, square: load current, sine: mean + amplitude
+  uint32_t spike;   // us, time of a one-sample spike to 5A, 0 for none
+  uint32_t interval; // us between samples
+  uint32_t duration; // us
+} SIM_Wave;
+
+static int32_t SIM_WaveValue(const SIM_Wave *wave, uint32_t time) {
+  double phase = (double)(time % wave->period) / wave->period;
+  if (wave->shape == 'q') {
+    return phase * 1000 < wave->duty ? wave->high : wave->low;
+  }
+  double mid = (wave->high + wave->low) / 2.0;
+  double amplitude = (wave->high - wave->low) / 2.0;
+  return (int32_t)lround(mid + amplitude * sin(2 * M_PI * phase));
+}
+
+static void SIM_CheckPeriod(const SIM_Wave *wave) {
+  PERIOD_Detector det;
+  PERIOD_Result last = {0};
+  uint32_t locked = 0; // cycles reported while locked, after the spike
+  char detail[160];
+
+  PERIOD_Init(&det);
+  // Start off a cycle boundary, the firmware samples at any phase
+  for (uint32_t time = 1234; time < wave->duration; time += wave->interval) {
+    int32_t current = SIM_WaveValue(wave, time);
+    if (wave->spike && time >= wave->spike &&
+        time < wave->spike + wave->interval) {
+      current = 5000;
+    }
+    if (PERIOD_Update(&det, time, current) && PERIOD_IsLocked(&det) &&
+        time > wave->spike) {
+      last = det.result;
+      locked++;
+    }
+  }
+
+  // A cycle is measured between two samples, it is exact to one interval.
+  // The samples of a sine miss its peak by a little.
+  int32_t average = wave->shape == 'q'
+                        ? (wave->high * wave->duty +
+                           wave->low * (1000 - wave->duty)) / 1000
+                        : (wave->high + wave->low) / 2;
+  int32_t swing = wave->high - wave->low;
+  uint32_t periodError = last.period > wave->period
+                             ? last.period - wave->period
+                             : wave->period - last.period;
+  uint32_t dutyError = 1000 * wave->interval / wave->period + 1;
+  int32_t peakError = wave->shape == 'q' ? 0 : swing / 20 + 1;
+  snprintf(detail, sizeof(detail),
+           "%u locked cycles, period %u us, duty %u, average %d mA, "
+           "peak %d mA",
+           locked, last.period, last.duty, last.average, last.peak);
+  SIM_Expect(wave->name,
+             locked > 0 && periodError <= wave->interval &&
+                 abs(last.average - average) <= swing / 20 + 1 &&
+                 wave->high - last.peak <= peakError &&
+                 (wave->shape != 'q' ||
+                  abs((int)last.duty - wave->duty) <= (int)dutyError),
+             detail);
+  printf("%-24s %4u cycles  %7u us  %4u permille  %5d mA avg  %5d mA peak\n",
+         wave->name, locked, last.period, last.duty, last.average, last.peak);
+}
+
+static const SIM_Wave SIM_Waves[] = {
+    // Fast mode, 2 ms between samples
+    {"square 37ms 30%", 'q', 37000, 300, 10, 410, 0, 2000, 3000000},
+    {"square 20ms 50%", 'q', 20000, 500, 100, 900, 0, 2000, 3000000},
+    {"square 100ms 10%", 'q', 100000, 100, 5, 305, 0, 2000, 5000000},
+    {"sine 250ms", 's', 250000, 0, 150, 250, 0, 2000, 5000000},
+    {"sine 41ms", 's', 41000, 0, -60, 60, 0, 2000, 3000000},
+    {"small square 40ms", 'q', 40000, 500, 0, 30, 0, 2000, 3000000},
+    // After a large transient the envelope has to shrink back to the
+    // small signal, or the thresholds stay out of its reach
+    {"small square after spike", 'q', 40000, 500, 0, 30, 500000, 2000,
+     4000000},
+    // Slow mode, 35 ms between samples
+    {"square 2s 40% slow", 'q', 2000000, 400, 20, 520, 0, 35000, 60000000},
+};
+
+// ---------------------------------------------------------------------------
+// INA219 in continuous mode: shunt and bus conversions alternate, and a
+// register holds the mean of the signal over the last conversion that
+// completed. A configuration write restarts them.
+
+typedef struct SIM_Sensor {
+  double (*signal)(const void *ctx, double time); // us -> mA or mV
+  const void *ctx;
+  uint32_t conversion; // us per conversion
+  uint32_t restart;    // us, last configuration write
+  uint8_t bus;         // 1 for the second conversion of a cycle
+  double value;        // register before the first conversion completes
+} SIM_Sensor;
+
+// Fast and slow profiles of ADAPT_DefaultConfig, with the default settings
+#define SIM_FAST_INTERVAL 2000
+#define SIM_FAST_CONVERSION 532
+#define SIM_SLOW_INTERVAL 35000
+#define SIM_SLOW_CONVERSION 17020
+
+static void SIM_Configure(SIM_Sensor *sensor, uint32_t time,
+                          uint32_t conversion) {
+  sensor->conversion = conversion;
+  sensor->restart = time;
+}
+
+static double SIM_Read(SIM_Sensor *sensor, uint32_t time) {
+  uint32_t cycle = 2 * sensor->conversion;
+  uint32_t offset = sensor->bus ? sensor->conversion : 0;
+  if (time - sensor->restart < offset + sensor->conversion) {
+    return sensor->value;
+  }
+  uint32_t cycles = (time - sensor->restart - offset - sensor->conversion) /
+                    cycle;
+  double start = (double)sensor->restart + offset + (double)cycles * cycle;
+  double sum = 0;
+  int steps = 64;
+  for (int i = 0; i < steps; i++) {
+    sum += sensor->signal(sensor->ctx,
+                          start + (i + 0.5) * sensor->conversion / steps);
+  }
+  sensor->value = sum / steps;
+  return sensor->value;
+}
+
+// ---------------------------------------------------------------------------
+// Bus voltage transitions
+
+typedef struct SIM_Step {
+  double time;      // us, start of the ramp
+  double ramp;      // us from the old to the new level
+  double from;      // mV
+  double to;        // mV
+  double overshoot; // mV beyond the new level, decaying over the ramp time
+} SIM_Step;
+
+static double SIM_StepValue(const void *ctx, double time) {
+  const SIM_Step *step = ctx;
+  if (time < step->time) {
+    return step->from;
+  }
+  double t = (time - step->time) / step->ramp;
+  if (t < 1) {
+    return step->from + (step->to - step->from + step->overshoot) * t;
+  }
+  double sign = step->to > step->from ? 1 : -1;
+  return step->to + sign * step->overshoot * (t < 2 ? 2 - t : 0);
+}
+
+// Runs the sampling loop of main() over a step, starting in the given mode.
+// A departing voltage boosts to fast mode like ADAPT_Boost. Returns the
+// logged event, or NULL.
+static const VBUS_Event *SIM_RunStep(VBUS_Log *log, const SIM_Step *step,
+                                     uint8_t fast) {
+  SIM_Sensor sensor = {SIM_StepValue, step, 0, 0, 1, step->from};
+  uint32_t interval = fast ? SIM_FAST_INTERVAL : SIM_SLOW_INTERVAL;
+  VBUS_Init(log);
+  SIM_Configure(&sensor, 0, fast ? SIM_FAST_CONVERSION : SIM_SLOW_CONVERSION);
+  for (uint32_t time = 1000000; time < 3000000; time += interval) {
+    // The register holds whole LSBs of 4 mV
+    int32_t bus = (int32_t)lround(SIM_Read(&sensor, time) / 4);
+    uint8_t events = VBUS_Update(log, time, bus * 4);
+    if ((events & VBUS_EVENT_START) && interval != SIM_FAST_INTERVAL) {
+      interval = SIM_FAST_INTERVAL;
+      SIM_Configure(&sensor, time, SIM_FAST_CONVERSION);
+    }
+    if (events & VBUS_EVENT_LOGGED) {
+      return VBUS_GetEvent(log, 0);
+    }
+  }
+  return NULL;
+}
+
+// The rise time of a step is exact to the bounds documented in vbus.h, over
+// every phase of the step against the sample clock
+static void SIM_CheckStep(const char *name, SIM_Step step, uint8_t fast) {
+  uint32_t interval = fast ? SIM_FAST_INTERVAL : SIM_SLOW_INTERVAL;
+  // True rise: until the voltage enters the settle band for good
+  double swing = fabs(step.to - step.from);
+  double rise = step.overshoot > VBUS_SETTLE_BAND
+                    ? step.ramp * (2 - VBUS_SETTLE_BAND / step.overshoot)
+                    : step.ramp * (swing - VBUS_SETTLE_BAND) /
+                          (swing + step.overshoot);
+  // vbus.h: at most two fast intervals and a conversion long; from slow
+  // mode nothing shorter than a slow interval can be resolved
+  double early = SIM_FAST_CONVERSION;
+  double late = 2 * SIM_FAST_INTERVAL + SIM_FAST_CONVERSION +
+                (!fast && rise < interval ? interval - rise : 0);
+  double minError = 1e9, maxError = -1e9;
+  double minOvershoot = 1e9;
+  int missed = 0;
+  double base = step.time;
+  char detail[160];
+
+  for (int phase = 0; phase < 100; phase++) {
+    VBUS_Log log;
+    step.time = base + (double)interval * phase / 100;
+    const VBUS_Event *event = SIM_RunStep(&log, &step, fast);
+    if (!event || abs((int)event->to - (int)step.to) > VBUS_SETTLE_BAND) {
+      missed++;
+      continue;
+    }
+    double error = (double)event->rise - rise;
+    minError = error < minError ? error : minError;
+    maxError = error > maxError ? error : maxError;
+    minOvershoot =
+        event->overshoot < minOvershoot ? event->overshoot : minOvershoot;
+  }
+  snprintf(detail, sizeof(detail),
+           "%d missed, rise error %.0f..%.0f us, allowed -%.0f..%.0f us",
+           missed, minError, maxError, early, late);
+  SIM_Expect(name, missed == 0 && minError >= -early && maxError <= late,
+             detail);
+  printf("%-24s rise %6.0f us, measured %6.0f..%6.0f us, overshoot "
+         "%4.0f mV, measured >= %4.0f mV\n",
+         name, rise, rise + minError, rise + maxError, step.overshoot,
+         minOvershoot);
+}
+
+// ---------------------------------------------------------------------------
+// Over-current alarm
+
+// Limits and calibration of main.c
+#define SIM_SHUNT_LSB 5000 // uA
+#define SIM_CURRENT_LIMIT 5500 // mA
+#define SIM_POWER_LIMIT 105000 // mW
+#define SIM_BUS 1250 // register value, 5V
+
+typedef struct SIM_Load {
+  double time; // us, start of the ramp
+  double ramp; // us, 0 for a step
+  double from; // mA
+  double to;   // mA
+} SIM_Load;
+
+static double SIM_LoadValue(const void *ctx, double time) {
+  const SIM_Load *load = ctx;
+  if (time < load->time) {
+    return load->from;
+  }
+  if (time >= load->time + load->ramp) {
+    return load->to;
+  }
+  return load->from + (load->to - load->from) * (time - load->time) /
+                          load->ramp;
+}
+
+// Runs the sampling loop of main() over a load change, with the real
+// acquisition controller deciding the mode. In fast mode it is boosted
+// half a second before, well within the holdoff, like by earlier activity. near = 0 ignores
+// ALARM_EVENT_NEAR. Returns us from the load crossing the limit to the
+// trip, or -1.
+static double SIM_RunAlarm(const SIM_Load *load, uint8_t fast, uint8_t near) {
+  ADAPT_Controller adapt;
+  ALARM_Monitor mon;
+  SIM_Sensor sensor = {SIM_LoadValue, load, 0, 0, 0, load->from};
+  static const uint32_t conversions[2] = {
+      [ADAPT_MODE_SLOW] = SIM_SLOW_CONVERSION,
+      [ADAPT_MODE_FAST] = SIM_FAST_CONVERSION,
+  };
+  // The load crosses the limit where the register rounds above it
+  double limit =
+      (SIM_CURRENT_LIMIT * 1000 / SIM_SHUNT_LSB + 0.5) * SIM_SHUNT_LSB / 1000;
+  double crossing = load->time;
+  if (load->ramp > 0) {
+    crossing += load->ramp * (limit - load->from) / (load->to - load->from);
+  }
+
+  ADAPT_Init(&adapt, &ADAPT_DefaultConfig);
+  ALARM_Init(&mon, SIM_CURRENT_LIMIT * 1000 / SIM_SHUNT_LSB,
+             SIM_POWER_LIMIT * 1000 / SIM_SHUNT_LSB * 250);
+  SIM_Configure(&sensor, 0, conversions[adapt.mode]);
+  uint8_t boosted = 0;
+  for (uint32_t time = 0; time < crossing + 2000000;
+       time += ADAPT_GetProfile(&adapt)->interval * 1000) {
+    int16_t shunt = (int16_t)lround(SIM_Read(&sensor, time) * 1000 /
+                                    SIM_SHUNT_LSB);
+    uint8_t alarmEvents = ALARM_CheckShunt(&mon, shunt, time);
+    if (alarmEvents & ALARM_EVENT_TRIP) {
+      return time - crossing;
+    }
+    alarmEvents |= ALARM_CheckPower(&mon, shunt, SIM_BUS);
+    uint8_t events = ADAPT_Update(&adapt, shunt, SIM_BUS,
+                                  shunt * SIM_SHUNT_LSB / 1000);
+    if (near && (alarmEvents & ALARM_EVENT_NEAR)) {
+      events |= ADAPT_Boost(&adapt);
+    }
+    if (fast && !boosted && time + 500000 >= load->time) {
+      boosted = 1;
+      events |= ADAPT_Boost(&adapt);
+    }
+    if (events & ADAPT_EVENT_MODE) {
+      SIM_Configure(&sensor, time, conversions[adapt.mode]);
+    }
+  }
+  return -1;
+}
+
+// The reaction time stays within the bound documented in alarm.h (without
+// the register read and loop overruns), over every phase of the load change
+// against the sample clock
+static void SIM_CheckAlarm(const char *name, SIM_Load load, uint8_t fast,
+                           double bound) {
+  double worst = 0, sum = 0, old = 0;
+  int missed = 0;
+  double base = load.time;
+  char detail[160];
+
+  for (int phase = 0; phase < 200; phase++) {
+    load.time = base + (double)SIM_SLOW_INTERVAL * phase / 200;
+    double reaction = SIM_RunAlarm(&load, fast, 1);
+    double without = SIM_RunAlarm(&load, fast, 0);
+    if (reaction < 0) {
+      missed++;
+      continue;
+    }
+    worst = reaction > worst ? reaction : worst;
+    old = without > old ? without : old;
+    sum += reaction;
+  }
+  snprintf(detail, sizeof(detail), "%d missed, worst %.0f us, allowed %.0f us",
+           missed, worst, bound);
+  SIM_Expect(name, missed == 0 && worst <= bound, detail);
+  printf("%-24s reaction %6.0f us mean, %6.0f us worst (%6.0f us without "
+         "near)\n",
+         name, sum / (200 - missed), worst, old);
+}
+
+// ---------------------------------------------------------------------------
+
+static int SIM_Check(void) {
+  for (size_t i = 0; i < sizeof(SIM_Waves) / sizeof(SIM_Waves[0]); i++) {
+    SIM_CheckPeriod(&SIM_Waves[i]);
+  }
+  SIM_CheckStep("5V -> 9V fast", (SIM_Step){1500000, 4000, 5000, 9000, 0}, 1);
+  SIM_CheckStep("9V -> 5V fast", (SIM_Step){1500000, 12000, 9000, 5000, 0},
+                1);
+  SIM_CheckStep("5V -> 12V overshoot fast",
+                (SIM_Step){1500000, 6000, 5000, 12000, 800}, 1);
+  SIM_CheckStep("5V -> 9V slow", (SIM_Step){1500000, 4000, 5000, 9000, 0}, 0);
+  SIM_CheckStep("5V -> 20V slow", (SIM_Step){1500000, 30000, 5000, 20000, 0},
+                0);
+  SIM_CheckStep("5V -> 12V overshoot slow",
+                (SIM_Step){1500000, 6000, 5000, 12000, 800}, 0);
+  // alarm.h: 3.6ms in fast mode and near a limit, 60ms from slow mode
+  SIM_CheckAlarm("0.1A -> 6A fast", (SIM_Load){3000000, 0, 100, 6000}, 1,
+                 3600);
+  SIM_CheckAlarm("5.3A -> 5.54A fast", (SIM_Load){3000000, 0, 5300, 5540}, 1,
+                 3600);
+  SIM_CheckAlarm("0.1A -> 6A slow", (SIM_Load){3000000, 0, 100, 6000}, 0,
+                 60000);
+  SIM_CheckAlarm("4A -> 8A slow", (SIM_Load){3000000, 0, 4000, 8000}, 0,
+                 60000);
+  SIM_CheckAlarm("5.3A -> 5.54A slow", (SIM_Load){3000000, 0, 5300, 5540}, 0,
+                 3600);
+  SIM_CheckAlarm("5.46A -> 5.51A slow", (SIM_Load){3000000, 0, 5460, 5510}, 0,
+                 3600);
+  SIM_CheckAlarm("4A -> 6A in 20s slow",
+                 (SIM_Load){3000000, 20000000, 4000, 6000}, 0, 3600);
+  printf("%d cases, %d failed\n", SIM_Cases, SIM_Failures);
+  return SIM_Failures != 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2 && strcmp(argv[1], "check") == 0) {
+    return SIM_Check();
+  }
+  fprintf(stderr, "usage: %s check\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,224 @@
+// Host check of the display number formatting in Src/fmt.c against snprintf.
+//
+// Usage: fmtcheck check  compare FMT_Fixed and FMT_Auto with an snprintf
+//                        reference for every value in +-2e6 at every scale
+//                        and decimals up to 3, and for random and edge
+//                        values over the whole int32 range at every scale
+//                        up to 9. Exit 1 on any difference.
+//        fmtcheck bench  time both against the snprintf calls they replace
+//
+// Build with cmake -S Tools/oledsim -B build-host.
+
+#include "fmt.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const uint32_t CHK_Pow10[] = {
+    1,      10,      100,      1000,      10000,
+    100000, 1000000, 10000000, 100000000, 1000000000,
+};
+
+static uint64_t CHK_Cases;
+static uint64_t CHK_Failures;
+
+// FMT_Fixed as documented: rounded half away from zero, no sign on a value
+// that rounds to zero, right-aligned to width
+static void CHK_Fixed(char *buf, size_t size, int32_t value, uint8_t scale,
+                      uint8_t decimals, uint8_t width, const char *unit) {
+  char text[32], fraction[16];
+  uint64_t magnitude = value < 0 ? -(int64_t)value : value;
+  if (decimals > scale) {
+    decimals = scale;
+  }
+  uint64_t div = CHK_Pow10[scale - decimals];
+  magnitude = (magnitude + div / 2) / div;
+  const char *sign = value < 0 && magnitude != 0 ? "-" : "";
+  if (decimals == 0) {
+    snprintf(text, sizeof(text), "%s%" PRIu64 "%s", sign, magnitude, unit);
+  } else {
+    // The fraction with its leading zeros, behind a 1 that is dropped
+    uint64_t one = CHK_Pow10[decimals];
+    snprintf(fraction, sizeof(fraction), "%" PRIu64, one + magnitude % one);
+    snprintf(text, sizeof(text), "%s%" PRIu64 ".%s%s", sign, magnitude / one,
+             fraction + 1, unit);
+  }
+  snprintf(buf, size, "%*s", width, text);
+}
+
+// FMT_Auto as documented: "m" below 1000, otherwise the most decimals (3, 2
+// or 1) that still leave at most four significant digits after rounding
+static void CHK_Auto(char *buf, size_t size, int32_t milli, uint8_t width,
+                     const char *unit) {
+  char prefixed[16];
+  uint64_t magnitude = milli < 0 ? -(int64_t)milli : milli;
+  if (magnitude < 1000) {
+    snprintf(prefixed, sizeof(prefixed), "m%s", unit);
+    CHK_Fixed(buf, size, milli, 0, 0, width, prefixed);
+    return;
+  }
+  uint8_t decimals = 3;
+  while (decimals > 1) {
+    uint64_t div = CHK_Pow10[3 - decimals];
+    if ((magnitude + div / 2) / div < 10000) {
+      break;
+    }
+    decimals--;
+  }
+  CHK_Fixed(buf, size, milli, 3, decimals, width, unit);
+}
+
+static void CHK_Report(const char *call, int32_t value, int scale,
+                       int decimals, int width, const char *got,
+                       const char *want) {
+  if (++CHK_Failures <= 20) {
+    printf("FAIL %s(%" PRId32 ", %d, %d, %d): \"%s\", expected \"%s\"\n", call,
+           value, scale, decimals, width, got, want);
+  }
+}
+
+static void CHK_Value(int32_t value, uint8_t maxScale) {
+  char got[40], want[40];
+  static const uint8_t widths[] = {0, 7};
+  for (size_t w = 0; w < sizeof(widths); w++) {
+    for (uint8_t scale = 0; scale <= maxScale; scale++) {
+      for (uint8_t decimals = 0; decimals <= scale; decimals++) {
+        FMT_Fixed(got, value, scale, decimals, widths[w], "mA");
+        CHK_Fixed(want, sizeof(want), value, scale, decimals, widths[w], "mA");
+        CHK_Cases++;
+        if (strcmp(got, want) != 0) {
+          CHK_Report("FMT_Fixed", value, scale, decimals, widths[w], got,
+                     want);
+        }
+      }
+    }
+    FMT_Auto(got, value, widths[w], "W");
+    CHK_Auto(want, sizeof(want), value, widths[w], "W");
+    CHK_Cases++;
+    if (strcmp(got, want) != 0) {
+      CHK_Report("FMT_Auto", value, 3, -1, widths[w], got, want);
+    }
+  }
+}
+
+static int CHK_Check(void) {
+  for (int32_t value = -2000000; value <= 2000000; value++) {
+    CHK_Value(value, 3);
+  }
+  // Both ends of the range, and around every rounding carry
+  static const int32_t edges[] = {INT32_MIN, INT32_MIN + 1, INT32_MAX,
+                                  INT32_MAX - 1, -1, 0, 1};
+  for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+    CHK_Value(edges[i], 9);
+  }
+  for (int digits = 1; digits <= 9; digits++) {
+    int32_t power = CHK_Pow10[digits];
+    for (int32_t d = -6; d <= 6; d++) {
+      CHK_Value(power + d, 9);
+      CHK_Value(-power + d, 9);
+      CHK_Value(power / 2 + d, 9);
+      CHK_Value(-power / 2 + d, 9);
+    }
+  }
+  srand(1);
+  for (int i = 0; i < 200000; i++) {
+    int32_t value = (int32_t)((uint32_t)rand() << 16 ^ (uint32_t)rand());
+    CHK_Value(value, 9);
+  }
+  printf("%" PRIu64 " cases, %" PRIu64 " failed\n", CHK_Cases, CHK_Failures);
+  return CHK_Failures != 0;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+
+#define CHK_BENCH_CALLS 2000000
+
+static volatile char CHK_Sink;
+
+static uint64_t CHK_Nanos(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+// Readouts of the main page: current up to 6A in mA, power up to 120W in mW
+static int32_t CHK_Input(int i, uint32_t range) {
+  return (int32_t)(i * 7919u % range);
+}
+
+static void CHK_BenchFixed(char *buf, int i) {
+  FMT_Fixed(buf, CHK_Input(i, 6000), 3, 3, 6, "A");
+}
+
+static void CHK_BenchFixedPrintf(char *buf, int i) {
+  int32_t value = CHK_Input(i, 6000);
+  snprintf(buf, 16, "%d.%03dA", (int)(value / 1000), (int)(value % 1000));
+}
+
+static void CHK_BenchAuto(char *buf, int i) {
+  FMT_Auto(buf, CHK_Input(i, 120000), 7, "W");
+}
+
+static void CHK_BenchAutoPrintf(char *buf, int i) {
+  int32_t value = CHK_Input(i, 120000);
+  if (value < 1000) {
+    snprintf(buf, 16, "%5dmW", (int)value);
+  } else if (value < 10000) {
+    snprintf(buf, 16, "%d.%03dW", (int)(value / 1000), (int)(value % 1000));
+  } else if (value < 100000) {
+    snprintf(buf, 16, "%d.%02dW", (int)(value / 1000),
+             (int)(value % 1000 / 10));
+  } else {
+    snprintf(buf, 16, "%d.%01dW", (int)(value / 1000),
+             (int)(value % 1000 / 100));
+  }
+}
+
+typedef struct CHK_Bench {
+  const char *name;
+  void (*call)(char *buf, int i);
+} CHK_Bench;
+
+static const CHK_Bench CHK_Benches[] = {
+    {"FMT_Fixed", CHK_BenchFixed},
+    {"snprintf fixed", CHK_BenchFixedPrintf},
+    {"FMT_Auto", CHK_BenchAuto},
+    {"snprintf auto", CHK_BenchAutoPrintf},
+};
+
+static int CHK_RunBenches(void) {
+  char buf[32];
+  printf("%-16s %8s\n", "call", "ns");
+  for (size_t b = 0; b < sizeof(CHK_Benches) / sizeof(CHK_Benches[0]); b++) {
+    double best = 1e18;
+    // Best of a few runs, to drop scheduler noise
+    for (int run = 0; run < 5; run++) {
+      uint64_t start = CHK_Nanos();
+      for (int i = 0; i < CHK_BENCH_CALLS; i++) {
+        CHK_Benches[b].call(buf, i);
+        CHK_Sink = buf[0];
+      }
+      double ns = (double)(CHK_Nanos() - start) / CHK_BENCH_CALLS;
+      if (ns < best) {
+        best = ns;
+      }
+    }
+    printf("%-16s %8.1f\n", CHK_Benches[b].name, best);
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2 && strcmp(argv[1], "check") == 0) {
+    return CHK_Check();
+  }
+  if (argc == 2 && strcmp(argv[1], "bench") == 0) {
+    return CHK_RunBenches();
+  }
+  fprintf(stderr, "usage: %s check | bench\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// Host replacement for Inc/main.h: the SSD1306 driver only needs the I2C
+// hook and the clock of the application, not the PY32 LL headers. Include it
+// before ssd1306.h, its guard keeps Inc/main.h out.
+#define __MAIN_H
+
+#include <stdint.h>
+
+extern volatile uint32_t APP_TickMs;
+void APP_I2C_Transmit(uint8_t devAddress, uint8_t memAddress, uint8_t *pData,
+                      uint16_t len);
+void APP_ErrorHandler(void);
+uint32_t APP_GetMicros(void);
@@ -0,0 +1,712 @@
+// Host build of the SSD1306 driver. Renders a fixed set of scenes, every font
+// of Src/ascii_fonts.c in both the row-major and the page-major path and
+// every drawing primitive, through the real Src/ssd1306.c into an emulated
+// panel, and saves them as PBM images. The golden set in Tools/oledsim/golden
+// is the reference every change is checked against, pixel by pixel.
+//
+// Usage: oledsim render [DIR] write DIR/<scene>.pbm, the golden set if
+//                             omitted: only after an intended change
+//        oledsim check [DIR]  compare with DIR/<scene>.pbm, the golden set
+//                             if omitted, exit 1 on any difference
+//        oledsim bench [-k K] time each draw call, K is M0+ cycles per host
+//                             ns, calibrated on a reference loop if omitted
+//
+// Build with cmake -S Tools/oledsim -B build-host, with the same
+// oled_page_mode and oled_double_buffer options as the firmware.
+
+#include "host.h"
+
+#include <stdio.h>
+#include <time.h>
+
+// The driver keeps its state static, include it to reach the framebuffer
+#include "ssd1306.c"
+#include "seg7.c"
+#include "ui.c"
+#include "page_fonts.h"
+
+#define SIM_PAGES (SSD1306_HEIGHT / 8)
+
+// ---------------------------------------------------------------------------
+// Emulated panel: horizontal addressing mode, column and page windows
+
+static uint8_t SIM_Ram[SIM_PAGES][SSD1306_WIDTH];
+static uint8_t SIM_Inverse;
+static uint8_t SIM_X0, SIM_X1 = SSD1306_WIDTH - 1, SIM_P0, SIM_P1 = SIM_PAGES - 1;
+static uint8_t SIM_X, SIM_P;
+static uint8_t SIM_Command, SIM_Args, SIM_ArgIndex, SIM_Arg[2];
+// Set to 0 to only count bytes, for benchmarks
+static uint8_t SIM_Panel = 1;
+static uint32_t SIM_BusBytes;
+
+volatile uint32_t APP_TickMs;
+
+static void SIM_Execute(uint8_t command) {
+  switch (command) {
+  case 0x21:
+    SIM_X0 = SIM_X = SIM_Arg[0];
+    SIM_X1 = SIM_Arg[1];
+    break;
+  case 0x22:
+    SIM_P0 = SIM_P = SIM_Arg[0];
+    SIM_P1 = SIM_Arg[1];
+    break;
+  case 0xA6:
+  case 0xA7:
+    SIM_Inverse = command & 1;
+    break;
+  }
+}
+
+static void SIM_Data(uint8_t data) {
+  if (SIM_P < SIM_PAGES && SIM_X < SSD1306_WIDTH) {
+    SIM_Ram[SIM_P][SIM_X] = data;
+  }
+  if (SIM_X == SIM_X1) {
+    SIM_X = SIM_X0;
+    SIM_P = SIM_P == SIM_P1 ? SIM_P0 : SIM_P + 1;
+  } else {
+    SIM_X++;
+  }
+}
+
+static uint8_t SIM_ArgCount(uint8_t command) {
+  switch (command) {
+  case 0x21:
+  case 0x22:
+    return 2;
+  case 0x20:
+  case 0x81:
+  case 0x8D:
+  case 0xA8:
+  case 0xD3:
+  case 0xD5:
+  case 0xD9:
+  case 0xDA:
+  case 0xDB:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+void APP_I2C_Transmit(uint8_t devAddress, uint8_t memAddress, uint8_t *pData,
+                      uint16_t len) {
+  SIM_BusBytes += len + 2;
+  if (!SIM_Panel) {
+    return;
+  }
+  for (uint16_t i = 0; i < len; i++) {
+    if (memAddress == 0x40) {
+      SIM_Data(pData[i]);
+    } else if (SIM_Args) {
+      if (SIM_ArgIndex < sizeof(SIM_Arg)) {
+        SIM_Arg[SIM_ArgIndex] = pData[i];
+      }
+      SIM_ArgIndex++;
+      if (--SIM_Args == 0) {
+        SIM_Execute(SIM_Command);
+      }
+    } else {
+      SIM_Command = pData[i];
+      SIM_Args = SIM_ArgCount(SIM_Command);
+      SIM_ArgIndex = 0;
+      if (SIM_Args == 0) {
+        SIM_Execute(SIM_Command);
+      }
+    }
+  }
+}
+
+void APP_ErrorHandler(void) {
+  fprintf(stderr, "APP_ErrorHandler called\n");
+  exit(2);
+}
+
+static uint64_t SIM_Nanos(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+uint32_t APP_GetMicros(void) { return SIM_Nanos() / 1000; }
+
+static uint8_t SIM_Pixel(uint8_t x, uint8_t y) {
+  return ((SIM_Ram[y / 8][x] >> (y % 8)) & 1) ^ SIM_Inverse;
+}
+
+// ---------------------------------------------------------------------------
+// Scenes
+
+typedef struct {
+  const char *name;
+  FontDef_t *font;
+  const PageFontDef_t *paged;
+} SIM_Font;
+
+// Keep in sync with page_fonts in CMakeLists.txt
+static const SIM_Font SIM_Fonts[] = {
+    {"3x5", &Font_3x5, &PageFont_3x5},
+    {"5x7", &Font_5x7, &PageFont_5x7},
+    {"6x8", &Font_6x8, &PageFont_6x8},
+    {"6x10", &Font_6x10, &PageFont_6x10},
+    {"6x12", &Font_6x12, &PageFont_6x12},
+    {"8x16", &Font_8x16, &PageFont_8x16},
+    {"11x18", &Font_11x18, &PageFont_11x18},
+    {"12x24", &Font_12x24, &PageFont_12x24},
+    {"16x26", &Font_16x26, &PageFont_16x26},
+    {"16x32", &Font_16x32, &PageFont_16x32},
+};
+#define SIM_FONT_COUNT (sizeof(SIM_Fonts) / sizeof(SIM_Fonts[0]))
+// Printable ASCII characters, ' ' to '~'
+#define SIM_CHARS 95
+
+typedef struct {
+  char name[32];
+  void (*draw)(int arg);
+  int arg;
+} SIM_Scene;
+
+static SIM_Scene SIM_Scenes[160];
+static int SIM_SceneCount;
+
+static void SIM_AddScene(const char *name, void (*draw)(int), int arg) {
+  SIM_Scene *scene = &SIM_Scenes[SIM_SceneCount++];
+  snprintf(scene->name, sizeof(scene->name), "%s", name);
+  scene->draw = draw;
+  scene->arg = arg;
+}
+
+static int SIM_GlyphsPerScreen(const FontDef_t *font) {
+  return (SSD1306_WIDTH / font->width) * (SSD1306_HEIGHT / font->height);
+}
+
+// arg: font index * 256 + screen, paged if bit 15 is set
+static void SIM_DrawFont(int arg) {
+  const SIM_Font *font = &SIM_Fonts[(arg >> 8) & 0x7F];
+  int perScreen = SIM_GlyphsPerScreen(font->font);
+  int columns = SSD1306_WIDTH / font->font->width;
+  int first = (arg & 0xFF) * perScreen;
+  for (int i = 0; i < perScreen && first + i < SIM_CHARS; i++) {
+    SSD1306_GotoXY(i % columns * font->font->width,
+                   i / columns * font->font->height);
+    char ch = ' ' + first + i;
+    if (arg & 0x8000) {
+      SSD1306_PutcPaged(ch, font->paged, SSD1306_COLOR_WHITE);
+    } else {
+      SSD1306_Putc(ch, font->font, SSD1306_COLOR_WHITE);
+    }
+  }
+}
+
+static void SIM_DrawTextBlack(int arg) {
+  SSD1306_FillRect(0, 0, SSD1306_WIDTH, SSD1306_HEIGHT, SSD1306_COLOR_WHITE);
+  SSD1306_GotoXY(1, 1);
+  SSD1306_Puts("Black 6x10", &Font_6x10, SSD1306_COLOR_BLACK);
+  SSD1306_GotoXY(3, 13);
+  SSD1306_PutsPaged("12.34", &PageFont_11x18, SSD1306_COLOR_BLACK);
+  SSD1306_GotoXY(70, 20);
+  SSD1306_PutsPaged("-5.0A", &PageFont_6x10, SSD1306_COLOR_BLACK);
+}
+
+static void SIM_DrawPixels(int arg) {
+  for (int y = 0; y < SSD1306_HEIGHT + 4; y++) {
+    for (int x = y % 3; x < SSD1306_WIDTH + 4; x += 3 + y % 5) {
+      SSD1306_DrawPixel(x, y, SSD1306_COLOR_WHITE);
+    }
+  }
+  for (int x = 0; x < SSD1306_WIDTH; x += 7) {
+    SSD1306_DrawPixel(x, x % SSD1306_HEIGHT, SSD1306_COLOR_BLACK);
+  }
+}
+
+static void SIM_DrawHVLines(int arg) {
+  for (int i = 0; i < 12; i++) {
+    SSD1306_DrawHLine(i * 11 - 8, i * 3 - 2, 20 + i * 2, SSD1306_COLOR_WHITE);
+    SSD1306_DrawVLine(i * 11 + 3, i * 2 - 4, 6 + i * 3, SSD1306_COLOR_WHITE);
+  }
+  SSD1306_DrawHLine(0, 16, SSD1306_WIDTH, SSD1306_COLOR_BLACK);
+  SSD1306_DrawVLine(64, 0, SSD1306_HEIGHT, SSD1306_COLOR_BLACK);
+  SSD1306_DrawHLine(10, 20, -5, SSD1306_COLOR_WHITE);
+}
+
+static void SIM_DrawRects(int arg) {
+  for (int i = 0; i < 6; i++) {
+    SSD1306_DrawRect(i * 2, i * 2, 60 - i * 4, 32 - i * 4, SSD1306_COLOR_WHITE);
+  }
+  SSD1306_DrawRect(110, -4, 30, 20, SSD1306_COLOR_WHITE);
+  SSD1306_DrawRect(70, 25, 10, 12, SSD1306_COLOR_WHITE);
+  SSD1306_DrawRect(90, 10, 1, 1, SSD1306_COLOR_WHITE);
+}
+
+static void SIM_DrawFillRects(int arg) {
+  SSD1306_FillRect(2, 1, 30, 13, SSD1306_COLOR_WHITE);
+  SSD1306_FillRect(8, 5, 10, 5, SSD1306_COLOR_BLACK);
+  SSD1306_FillRect(36, 3, 5, 26, SSD1306_COLOR_WHITE);
+  SSD1306_FillRect(44, 7, 40, 2, SSD1306_COLOR_WHITE);
+  SSD1306_FillRect(44, 15, 40, 17, SSD1306_COLOR_WHITE);
+  SSD1306_FillRect(-5, 28, 20, 10, SSD1306_COLOR_WHITE);
+  SSD1306_FillRect(120, -3, 20, 9, SSD1306_COLOR_WHITE);
+  SSD1306_FillRect(90, 0, 30, 32, SSD1306_COLOR_WHITE);
+  SSD1306_FillRect(95, 9, 20, 14, SSD1306_COLOR_BLACK);
+}
+
+static void SIM_DrawFillInvert(int arg) {
+  for (int y = 0; y < SSD1306_HEIGHT; y += 4) {
+    for (int x = (y / 4) % 2 * 4; x < SSD1306_WIDTH; x += 8) {
+      SSD1306_FillRect(x, y, 4, 4, SSD1306_COLOR_WHITE);
+    }
+  }
+  SSD1306_FillRect(10, 3, 50, 20, SSD1306_COLOR_INVERT);
+  SSD1306_FillRect(40, 10, 60, 19, SSD1306_COLOR_INVERT);
+  SSD1306_FillRect(100, -2, 40, 7, SSD1306_COLOR_INVERT);
+}
+
+static void SIM_DrawBars(int arg) {
+  for (int i = 0; i <= 10; i++) {
+    SSD1306_DrawBar(0, i * 3, 60 + i, 2, i * 10, 100);
+  }
+  for (int i = 0; i <= 8; i++) {
+    SSD1306_DrawBar(76 + i * 6, 0, 5, 32, i, 8);
+  }
+}
+
+static void SIM_DrawLines(int arg) {
+  for (int x = 0; x < SSD1306_WIDTH; x += 9) {
+    SSD1306_DrawLine(64, 16, x, 0, SSD1306_COLOR_WHITE);
+    SSD1306_DrawLine(64, 16, x, SSD1306_HEIGHT - 1, SSD1306_COLOR_WHITE);
+  }
+  for (int y = 0; y < SSD1306_HEIGHT; y += 5) {
+    SSD1306_DrawLine(0, y, 20, SSD1306_HEIGHT - 1 - y, SSD1306_COLOR_WHITE);
+    SSD1306_DrawLine(127, y, 107, y, SSD1306_COLOR_WHITE);
+  }
+  SSD1306_DrawLine(64, 0, 64, 31, SSD1306_COLOR_BLACK);
+  SSD1306_DrawLine(100, 5, 140, 40, SSD1306_COLOR_WHITE);
+}
+
+static void SIM_DrawCircles(int arg) {
+  for (int r = 1; r < 16; r += 3) {
+    SSD1306_DrawCircle(20, 16, r, SSD1306_COLOR_WHITE);
+  }
+  SSD1306_DrawCircle(64, 16, 30, SSD1306_COLOR_WHITE);
+  SSD1306_DrawCircle(120, 0, 12, SSD1306_COLOR_WHITE);
+  SSD1306_DrawCircle(-3, 30, 8, SSD1306_COLOR_WHITE);
+  SSD1306_DrawCircle(90, 20, 0, SSD1306_COLOR_WHITE);
+}
+
+// 13x37 pixels, 3 frames of fixed pseudo-random bits
+static uint8_t SIM_ImageData[5 + 3 * ((13 * 37 + 7) / 8)];
+
+static void SIM_InitImage(void) {
+  uint32_t seed = 12345;
+  uint16_t size = (13 * 37 + 7) / 8;
+  SIM_ImageData[0] = 13;
+  SIM_ImageData[1] = 37;
+  SIM_ImageData[2] = 3;
+  SIM_ImageData[3] = size & 0xFF;
+  SIM_ImageData[4] = size >> 8;
+  for (size_t i = 5; i < sizeof(SIM_ImageData); i++) {
+    seed = seed * 1103515245 + 12345;
+    SIM_ImageData[i] = seed >> 16;
+  }
+}
+
+static void SIM_DrawImage(int arg) {
+  SSD1306_Image(SIM_ImageData, 0, 0, 0);
+  SSD1306_Image(SIM_ImageData, 1, 20, 3);
+  SSD1306_Image(SIM_ImageData, 2, 40, 0);
+  SSD1306_Image(SIM_ImageData, 0, 120, 5);
+  SSD1306_Image(SIM_ImageData, 3, 60, 0);
+}
+
+static void SIM_DrawColumns(int arg) {
+  for (int x = 0; x < SSD1306_WIDTH; x++) {
+    uint32_t bits = 0x12345678u * (x + 1);
+    uint32_t mask = x % 4 == 0 ? 0xFFFFFFFFu : 0x0FF0F00Fu << (x % 5);
+    SSD1306_DrawColumn(x, x % 7, bits, mask);
+  }
+}
+
+static void SIM_DrawScroll(int arg) {
+  SIM_DrawLines(0);
+  SSD1306_ScrollLeft(40, 127, 0, SIM_PAGES - 1, 13);
+  SSD1306_ScrollLeft(0, 30, 1, 2, 5);
+}
+
+static void SIM_DrawSeg7(int arg) {
+  int16_t x = 0;
+  for (const char *c = "-0123"; *c; c++) {
+    x += SEG7_DrawChar(x, 0, 32, *c);
+  }
+  x += SEG7_DrawChar(x, 0, 32, '.');
+  for (const char *c = "456789"; *c; c++) {
+    x += SEG7_DrawChar(x, 0, 18, *c);
+  }
+  x = 70;
+  for (const char *c = "12.3-0"; *c; c++) {
+    x += SEG7_DrawChar(x, 20, 10, *c);
+  }
+}
+
+#ifndef SSD1306_PAGE_MODE
+static void SIM_DrawToggleInvert(int arg) {
+  SSD1306_GotoXY(2, 2);
+  SSD1306_Puts("Inverted", &Font_6x10, SSD1306_COLOR_WHITE);
+  SSD1306_ToggleInvert();
+  SSD1306_FillRect(70, 4, 20, 20, SSD1306_COLOR_WHITE);
+  SSD1306_DrawCircle(100, 16, 10, SSD1306_COLOR_BLACK);
+}
+#endif
+
+static void SIM_InitScenes(void) {
+  char name[32];
+  for (size_t f = 0; f < SIM_FONT_COUNT; f++) {
+    int perScreen = SIM_GlyphsPerScreen(SIM_Fonts[f].font);
+    int screens = (SIM_CHARS + perScreen - 1) / perScreen;
+    for (int s = 0; s < screens; s++) {
+      snprintf(name, sizeof(name), "font_%s_%d", SIM_Fonts[f].name, s);
+      SIM_AddScene(name, SIM_DrawFont, f << 8 | s);
+      snprintf(name, sizeof(name), "page_%s_%d", SIM_Fonts[f].name, s);
+      SIM_AddScene(name, SIM_DrawFont, 0x8000 | f << 8 | s);
+    }
+  }
+  SIM_AddScene("text_black", SIM_DrawTextBlack, 0);
+  SIM_AddScene("pixels", SIM_DrawPixels, 0);
+  SIM_AddScene("hvlines", SIM_DrawHVLines, 0);
+  SIM_AddScene("rects", SIM_DrawRects, 0);
+  SIM_AddScene("fill_rects", SIM_DrawFillRects, 0);
+  SIM_AddScene("fill_invert", SIM_DrawFillInvert, 0);
+  SIM_AddScene("bars", SIM_DrawBars, 0);
+  SIM_AddScene("lines", SIM_DrawLines, 0);
+  SIM_AddScene("circles", SIM_DrawCircles, 0);
+  SIM_AddScene("image", SIM_DrawImage, 0);
+  SIM_AddScene("columns", SIM_DrawColumns, 0);
+  SIM_AddScene("scroll", SIM_DrawScroll, 0);
+  SIM_AddScene("seg7", SIM_DrawSeg7, 0);
+#ifndef SSD1306_PAGE_MODE
+  SIM_AddScene("toggle_invert", SIM_DrawToggleInvert, 0);
+#endif
+}
+
+// Draws a scene and sends it to the panel. Returns 0 if the panel does not
+// match the framebuffer afterwards.
+static int SIM_Render(const SIM_Scene *scene) {
+#ifdef SSD1306_PAGE_MODE
+  for (uint8_t page = 0; page < SIM_PAGES; page++) {
+    SSD1306_BeginPage(page);
+    scene->draw(scene->arg);
+    SSD1306_UpdateScreen();
+  }
+  return 1;
+#else
+  SSD1306_Fill(SSD1306_COLOR_BLACK);
+  scene->draw(scene->arg);
+  SSD1306_UpdateScreen();
+  int synced = memcmp(SIM_Ram, SSD1306_Buffer_all, sizeof(SIM_Ram)) == 0;
+  if (SSD1306.Inverted) {
+    SSD1306_ToggleInvert();
+  }
+  return synced;
+#endif
+}
+
+// ---------------------------------------------------------------------------
+// PBM files, P4: rows of MSB-first bytes, 1 is black
+
+static int SIM_Save(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    perror(path);
+    return 0;
+  }
+  fprintf(f, "P4\n%d %d\n", SSD1306_WIDTH, SSD1306_HEIGHT);
+  for (uint8_t y = 0; y < SSD1306_HEIGHT; y++) {
+    for (uint8_t x = 0; x < SSD1306_WIDTH; x += 8) {
+      uint8_t byte = 0;
+      for (uint8_t i = 0; i < 8; i++) {
+        byte |= !SIM_Pixel(x + i, y) << (7 - i);
+      }
+      fputc(byte, f);
+    }
+  }
+  return fclose(f) == 0;
+}
+
+// Returns the number of pixels that differ from the image at path, -1 if it
+// cannot be read
+static int SIM_Compare(const char *path, int *firstX, int *firstY) {
+  FILE *f = fopen(path, "rb");
+  int width, height, diff = 0;
+  if (!f) {
+    return -1;
+  }
+  if (fscanf(f, "P4 %d %d", &width, &height) != 2 ||
+      width != SSD1306_WIDTH || height != SSD1306_HEIGHT || fgetc(f) == EOF) {
+    fclose(f);
+    return -1;
+  }
+  for (uint8_t y = 0; y < SSD1306_HEIGHT; y++) {
+    for (uint8_t x = 0; x < SSD1306_WIDTH; x += 8) {
+      int byte = fgetc(f);
+      if (byte == EOF) {
+        fclose(f);
+        return -1;
+      }
+      for (uint8_t i = 0; i < 8; i++) {
+        if (((byte >> (7 - i)) & 1) == SIM_Pixel(x + i, y) && diff++ == 0) {
+          *firstX = x + i;
+          *firstY = y;
+        }
+      }
+    }
+  }
+  fclose(f);
+  return diff;
+}
+
+static int SIM_RunScenes(const char *dir, int check) {
+  char path[512];
+  int failed = 0;
+  for (int i = 0; i < SIM_SceneCount; i++) {
+    const SIM_Scene *scene = &SIM_Scenes[i];
+    if (snprintf(path, sizeof(path), "%s/%s.pbm", dir, scene->name) >=
+        (int)sizeof(path)) {
+      printf("%-16s path too long\n", scene->name);
+      return 1;
+    }
+    if (!SIM_Render(scene)) {
+      printf("%-16s panel differs from the framebuffer\n", scene->name);
+      failed++;
+    }
+    if (!check) {
+      failed += !SIM_Save(path);
+      continue;
+    }
+    int x = 0, y = 0;
+    int diff = SIM_Compare(path, &x, &y);
+    if (diff < 0) {
+      printf("%-16s cannot read %s\n", scene->name, path);
+      failed++;
+    } else if (diff > 0) {
+      printf("%-16s %d pixels differ, first at %d,%d\n", scene->name, diff, x,
+             y);
+      failed++;
+    }
+  }
+  printf("%d scenes, %d failed\n", SIM_SceneCount, failed);
+  return failed ? 1 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+
+#define SIM_BENCH_CALLS 20000
+
+// Call arguments drawn from a fixed sequence, the same on every run
+static uint32_t SIM_Seed;
+
+static uint32_t SIM_Random(uint32_t range) {
+  SIM_Seed = SIM_Seed * 1664525 + 1013904223;
+  return (SIM_Seed >> 8) % range;
+}
+
+static void SIM_BenchPixel(void) {
+  SSD1306_DrawPixel(SIM_Random(SSD1306_WIDTH), SIM_Random(SSD1306_HEIGHT),
+                    SIM_Random(2));
+}
+
+static void SIM_BenchHLine(void) {
+  SSD1306_DrawHLine(SIM_Random(64), SIM_Random(SSD1306_HEIGHT), 64, 1);
+}
+
+static void SIM_BenchVLine(void) {
+  SSD1306_DrawVLine(SIM_Random(SSD1306_WIDTH), SIM_Random(8), 24, 1);
+}
+
+static void SIM_BenchFillRect(void) {
+  SSD1306_FillRect(SIM_Random(96), SIM_Random(16), 32, 16, SIM_Random(3));
+}
+
+static void SIM_BenchBar(void) {
+  SSD1306_DrawBar(0, 24, SSD1306_WIDTH, 8, SIM_Random(1001), 1000);
+}
+
+static void SIM_BenchLine(void) {
+  SSD1306_DrawLine(SIM_Random(SSD1306_WIDTH), SIM_Random(SSD1306_HEIGHT),
+                   SIM_Random(SSD1306_WIDTH), SIM_Random(SSD1306_HEIGHT), 1);
+}
+
+static void SIM_BenchCircle(void) {
+  SSD1306_DrawCircle(SIM_Random(SSD1306_WIDTH), SIM_Random(SSD1306_HEIGHT),
+                     SIM_Random(16), 1);
+}
+
+static void SIM_BenchColumn(void) {
+  SSD1306_DrawColumn(SIM_Random(SSD1306_WIDTH), 0, SIM_Seed, 0xFFFFFFFF);
+}
+
+static void SIM_BenchPutc(void) {
+  SSD1306_GotoXY(SIM_Random(100), SIM_Random(8));
+  SSD1306_Putc('0' + SIM_Random(10), &Font_11x18, 1);
+}
+
+static void SIM_BenchPutcPaged(void) {
+  SSD1306_GotoXY(SIM_Random(100), SIM_Random(2) * 8);
+  SSD1306_PutcPaged('0' + SIM_Random(10), &PageFont_11x18, 1);
+}
+
+static void SIM_BenchPutcPagedSmall(void) {
+  SSD1306_GotoXY(SIM_Random(120), SIM_Random(3) * 8);
+  SSD1306_PutcPaged('0' + SIM_Random(10), &PageFont_6x8, 1);
+}
+
+// The readouts of the main page: on a page boundary, and between two
+static void SIM_BenchPutcPagedField(void) {
+  SSD1306_GotoXY(SIM_Random(120), 0);
+  SSD1306_PutcPaged('0' + SIM_Random(10), &PageFont_6x10, 1);
+}
+
+static void SIM_BenchPutcPagedFieldUnaligned(void) {
+  SSD1306_GotoXY(SIM_Random(120), 11);
+  SSD1306_PutcPaged('0' + SIM_Random(10), &PageFont_6x10, 1);
+}
+
+static void SIM_BenchPutcLarge(void) {
+  SSD1306_GotoXY(SIM_Random(112), 0);
+  SSD1306_Putc('0' + SIM_Random(10), &Font_16x32, 1);
+}
+
+static void SIM_BenchPutcPagedLarge(void) {
+  SSD1306_GotoXY(SIM_Random(112), 0);
+  SSD1306_PutcPaged('0' + SIM_Random(10), &PageFont_16x32, 1);
+}
+
+static void SIM_BenchSeg7(void) {
+  SEG7_DrawChar(SIM_Random(110), SIM_Random(2) * 8, 18, '0' + SIM_Random(10));
+}
+
+static void SIM_BenchSeg7Large(void) {
+  SEG7_DrawChar(SIM_Random(110), 0, 32, '0' + SIM_Random(10));
+}
+
+static void SIM_BenchImage(void) {
+  SSD1306_Image(SIM_ImageData, SIM_Random(3), SIM_Random(110), 0);
+}
+
+static void SIM_BenchFill(void) { SSD1306_Fill(SIM_Random(2)); }
+
+// A few changed glyphs and a full update, the I2C transfer is not emulated
+static void SIM_BenchUpdate(void) {
+  SSD1306_GotoXY(SIM_Random(4) * 11, 0);
+  SSD1306_PutcPaged('0' + SIM_Random(10), &PageFont_11x18, 1);
+  SSD1306_UpdateScreen();
+}
+
+typedef struct {
+  const char *name;
+  void (*call)(void);
+} SIM_Bench;
+
+static const SIM_Bench SIM_Benches[] = {
+    {"DrawPixel", SIM_BenchPixel},
+    {"DrawHLine 64", SIM_BenchHLine},
+    {"DrawVLine 24", SIM_BenchVLine},
+    {"FillRect 32x16", SIM_BenchFillRect},
+    {"DrawBar 128x8", SIM_BenchBar},
+    {"DrawLine", SIM_BenchLine},
+    {"DrawCircle", SIM_BenchCircle},
+    {"DrawColumn 32", SIM_BenchColumn},
+    {"Putc 11x18", SIM_BenchPutc},
+    {"PutcPaged 11x18", SIM_BenchPutcPaged},
+    {"PutcPaged 6x8", SIM_BenchPutcPagedSmall},
+    {"PutcPaged 6x10 y=0", SIM_BenchPutcPagedField},
+    {"PutcPaged 6x10 y=11", SIM_BenchPutcPagedFieldUnaligned},
+    {"Putc 16x32", SIM_BenchPutcLarge},
+    {"PutcPaged 16x32", SIM_BenchPutcPagedLarge},
+    {"SEG7 digit 18", SIM_BenchSeg7},
+    {"SEG7 digit 32", SIM_BenchSeg7Large},
+    {"Image 13x37", SIM_BenchImage},
+    {"Fill", SIM_BenchFill},
+    {"Update 1 glyph", SIM_BenchUpdate},
+};
+
+// M0+ cycles of one iteration of the reference loop: muls, adds, adds, cmp
+// and a taken branch. Its host time gives the cycles per ns ratio; a rough
+// estimate, the host runs memory-heavy code relatively faster.
+#define SIM_REFERENCE_CYCLES 6
+
+static volatile uint32_t SIM_Sink;
+
+static double SIM_Calibrate(void) {
+  const uint32_t n = 50000000;
+  uint32_t x = 1;
+  uint64_t start = SIM_Nanos();
+  for (uint32_t i = 0; i < n; i++) {
+    x = x * 1664525 + 1013904223;
+  }
+  SIM_Sink = x;
+  double ns = (double)(SIM_Nanos() - start) / n;
+  return SIM_REFERENCE_CYCLES / ns;
+}
+
+static int SIM_RunBenches(double cyclesPerNs) {
+  if (cyclesPerNs <= 0) {
+    cyclesPerNs = SIM_Calibrate();
+  }
+  printf("%-18s %10s %12s %10s %10s\n", "call", "ns", "M0+ cycles",
+         "us@24MHz", "bus bytes");
+  SIM_Panel = 0;
+#ifdef SSD1306_PAGE_MODE
+  SSD1306_BeginPage(0);
+#endif
+  for (size_t b = 0; b < sizeof(SIM_Benches) / sizeof(SIM_Benches[0]); b++) {
+    const SIM_Bench *bench = &SIM_Benches[b];
+    double best = 1e18;
+    uint32_t bytes = 0;
+    // Best of a few runs, to drop scheduler noise
+    for (int run = 0; run < 5; run++) {
+      SIM_Seed = 1;
+      SIM_BusBytes = 0;
+      SSD1306_Fill(SSD1306_COLOR_BLACK);
+      uint64_t start = SIM_Nanos();
+      for (int i = 0; i < SIM_BENCH_CALLS; i++) {
+        bench->call();
+      }
+      double ns = (double)(SIM_Nanos() - start) / SIM_BENCH_CALLS;
+      if (ns < best) {
+        best = ns;
+      }
+      bytes = SIM_BusBytes / SIM_BENCH_CALLS;
+    }
+    double cycles = best * cyclesPerNs;
+    printf("%-18s %10.1f %12.0f %10.1f %10u\n", bench->name, best, cycles,
+           cycles / 24, bytes);
+  }
+  SIM_Panel = 1;
+  printf("%.2f M0+ cycles per host ns\n", cyclesPerNs);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  SIM_InitImage();
+  SIM_InitScenes();
+  SSD1306_Init();
+
+  if (argc >= 2 && argc <= 3 && strcmp(argv[1], "render") == 0) {
+    return SIM_RunScenes(argc == 3 ? argv[2] : SIM_GOLDEN_DIR, 0);
+  }
+  if (argc >= 2 && argc <= 3 && strcmp(argv[1], "check") == 0) {
+    return SIM_RunScenes(argc == 3 ? argv[2] : SIM_GOLDEN_DIR, 1);
+  }
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    double k = 0;
+    if (argc == 4 && strcmp(argv[2], "-k") == 0) {
+      k = atof(argv[3]);
+    }
+    return SIM_RunBenches(k);
+  }
+  fprintf(stderr,
+          "usage: %s render [DIR] | check [DIR] | bench [-k CYCLES_PER_NS]\n",
+          argv[0]);
+  return 2;
+}
@@ -0,0 +1,280 @@
+// Host side of the serial command shell, see Inc/shell.h. The firmware's own
+// Src/shell.c answers on the master side of a pseudo-terminal, fed a byte at a
+// time the way APP_PollSerial feeds it from the USART.
+//
+// Usage: shellsim pty    serve the shell on a new pty, print the path of its
+//                        slave side and answer until interrupted, e.g. for
+//                        picocom or a capture tool
+//        shellsim check  drive the command grammar through a pty, exit 1 on
+//                        any mismatch
+//
+// The variables and commands stand in for the ones of Src/main.c.
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+
+#include "shell.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+static SHELL_State SIM_Shell;
+static int SIM_Master = -1;
+// Bytes the output may still take, -1 for no limit. Stands in for the room
+// left in the USART ring buffer.
+static int SIM_Room = -1;
+
+static int32_t SIM_Output;
+static int32_t SIM_ShuntLsb = 5000;
+static int32_t SIM_FastMs = 2;
+static int32_t SIM_SlowMs = 140;
+static int SIM_Streaming = 1;
+static int SIM_Changes;
+
+static const char *const SIM_OutputNames[] = {"text", "binary", "delta"};
+
+static const SHELL_Var SIM_Vars[] = {
+    {"output", &SIM_Output, 0, 2, SIM_OutputNames},
+    {"shunt_lsb", &SIM_ShuntLsb, 20, 50000, NULL},
+    {"fast_ms", &SIM_FastMs, 1, 1000, NULL},
+    {"slow_ms", &SIM_SlowMs, 1, 10000, NULL},
+};
+
+static uint8_t SIM_Stream(uint8_t argc, char **argv, uint8_t index,
+                          char *reply) {
+  if (argc != 2) {
+    return SHELL_USAGE;
+  }
+  if (strcmp(argv[1], "start") == 0) {
+    SIM_Streaming = 1;
+  } else if (strcmp(argv[1], "stop") == 0) {
+    SIM_Streaming = 0;
+  } else {
+    return SHELL_USAGE;
+  }
+  strcpy(reply, "ok");
+  return SHELL_DONE;
+}
+
+static const SHELL_Command SIM_Commands[] = {
+    {"stream", "start|stop", SIM_Stream},
+};
+
+static void SIM_Changed(const SHELL_Var *var) { SIM_Changes++; }
+
+static uint16_t SIM_Write(const void *data, uint16_t len) {
+  // Like UART_Write, a line goes out whole or not at all
+  if (SIM_Room >= 0) {
+    if (len > SIM_Room) {
+      return 0;
+    }
+    SIM_Room -= len;
+  }
+  const char *p = data;
+  for (uint16_t left = len; left > 0;) {
+    ssize_t n = write(SIM_Master, p, left);
+    if (n <= 0) {
+      perror("pty write");
+      exit(1);
+    }
+    p += n;
+    left -= n;
+  }
+  return len;
+}
+
+static const SHELL_Config SIM_Config = {
+    SIM_Commands, sizeof(SIM_Commands) / sizeof(SIM_Commands[0]),
+    SIM_Vars,     sizeof(SIM_Vars) / sizeof(SIM_Vars[0]),
+    SIM_Changed,  SIM_Write,
+};
+
+// Same loop as APP_PollSerial
+static void SIM_Poll(void) {
+  uint8_t byte;
+  while (SHELL_Execute(&SIM_Shell) && read(SIM_Master, &byte, 1) == 1) {
+    SHELL_Input(&SIM_Shell, byte);
+  }
+}
+
+// Opens a pty, the master side non-blocking for SIM_Poll. Returns the slave
+// side in raw mode, so that line ends pass unchanged and nothing is echoed.
+static int SIM_OpenPty(void) {
+  SIM_Master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (SIM_Master < 0 || grantpt(SIM_Master) || unlockpt(SIM_Master)) {
+    perror("pty");
+    exit(1);
+  }
+  fcntl(SIM_Master, F_SETFL, O_NONBLOCK);
+  int slave = open(ptsname(SIM_Master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  struct termios tio;
+  if (slave < 0 || tcgetattr(slave, &tio)) {
+    perror(ptsname(SIM_Master));
+    exit(1);
+  }
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  SHELL_Init(&SIM_Shell, &SIM_Config);
+  return slave;
+}
+
+static int SIM_Serve(void) {
+  // Keep the slave open, the master reports a hangup while no one has it
+  int slave = SIM_OpenPty();
+  printf("%s\n", ptsname(SIM_Master));
+  fflush(stdout);
+  while (1) {
+    struct pollfd fd = {SIM_Master, POLLIN, 0};
+    poll(&fd, 1, 100);
+    SIM_Poll();
+  }
+  close(slave);
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Grammar checks
+
+static int SIM_Failures;
+static int SIM_Slave = -1;
+
+// Sends text from the host side and compares everything that comes back,
+// draining room bytes of output per step if throttled
+static void SIM_Expect(const char *send, const char *expect, int room) {
+  char got[1024];
+  size_t len = 0;
+  size_t want = strlen(expect);
+  int quiet = 0;
+  if (write(SIM_Slave, send, strlen(send)) != (ssize_t)strlen(send)) {
+    perror("pty write");
+    exit(1);
+  }
+  SIM_Room = room ? 0 : -1;
+  // Run until the reply is complete and then some, to catch extra lines
+  for (int step = 0; step < 10000 && quiet < 20; step++) {
+    if (room) {
+      SIM_Room += room;
+    }
+    SIM_Poll();
+    struct pollfd fd = {SIM_Slave, POLLIN, 0};
+    poll(&fd, 1, len >= want ? 1 : 10);
+    ssize_t n = read(SIM_Slave, got + len, sizeof(got) - 1 - len);
+    if (n > 0) {
+      len += n;
+      quiet = 0;
+    } else if (len >= want) {
+      quiet++;
+    }
+  }
+  got[len] = '\0';
+  if (strcmp(got, expect) != 0) {
+    printf("FAIL %s", send);
+    printf("  expected:\n%s  got:\n%s", expect, got);
+    SIM_Failures++;
+  }
+}
+
+static int SIM_Check(void) {
+  SIM_Slave = SIM_OpenPty();
+  static const char help[] = "get [name]\n"
+                             "set <name> <value>\n"
+                             "help\n"
+                             "stream start|stop\n"
+                             "output: text binary delta\n"
+                             "shunt_lsb 20..50000\n"
+                             "fast_ms 1..1000\n"
+                             "slow_ms 1..10000\n";
+  static const char all[] = "output text\n"
+                            "shunt_lsb 5000\n"
+                            "fast_ms 2\n"
+                            "slow_ms 140\n";
+
+  // Reads, and every line end
+  SIM_Expect("get shunt_lsb\n", "shunt_lsb 5000\n", 0);
+  SIM_Expect("get fast_ms\r", "fast_ms 2\n", 0);
+  SIM_Expect("get slow_ms\r\n", "slow_ms 140\n", 0);
+  SIM_Expect("  get   output  \n", "output text\n", 0);
+  SIM_Expect("\r\n\n\r", "", 0);
+  SIM_Expect("get\n", all, 0);
+  SIM_Expect("help\n", help, 0);
+
+  // Writes
+  SIM_Expect("set shunt_lsb 1000\n", "ok\n", 0);
+  SIM_Expect("get shunt_lsb\n", "shunt_lsb 1000\n", 0);
+  SIM_Expect("set output binary\n", "ok\n", 0);
+  SIM_Expect("get output\n", "output binary\n", 0);
+  SIM_Expect("set fast_ms -0\n", "error: out of range\n", 0);
+  SIM_Expect("set shunt_lsb 19\n", "error: out of range\n", 0);
+  SIM_Expect("set shunt_lsb 50001\n", "error: out of range\n", 0);
+  SIM_Expect("set shunt_lsb 99999999999\n", "error: bad value\n", 0);
+  SIM_Expect("set shunt_lsb 12a\n", "error: bad value\n", 0);
+  SIM_Expect("set shunt_lsb -\n", "error: bad value\n", 0);
+  SIM_Expect("set output 1\n", "error: bad value\n", 0);
+  SIM_Expect("get shunt_lsb\n", "shunt_lsb 1000\n", 0);
+  if (SIM_Changes != 2) {
+    printf("FAIL %d changes instead of 2\n", SIM_Changes);
+    SIM_Failures++;
+  }
+
+  // Commands and malformed lines
+  SIM_Expect("stream stop\n", "ok\n", 0);
+  SIM_Expect("stream\n", "error: usage: stream start|stop\n", 0);
+  SIM_Expect("stream pause\n", "error: usage: stream start|stop\n", 0);
+  SIM_Expect("set output\n", "error: usage: set <name> <value>\n", 0);
+  SIM_Expect("get a b\n", "error: usage: get [name]\n", 0);
+  SIM_Expect("get nope\n", "error: unknown variable\n", 0);
+  SIM_Expect("set nope 1\n", "error: unknown variable\n", 0);
+  SIM_Expect("frob\n", "error: unknown command, try help\n", 0);
+  SIM_Expect("GET output\n", "error: unknown command, try help\n", 0);
+  SIM_Expect("a b c d e\n", "error: too many words\n", 0);
+  SIM_Expect("set output text and more words than fit in a line\n",
+             "error: line too long\n", 0);
+  // The longest line still passes, one more character does not
+  SIM_Expect("set shunt_lsb 00000000000005000\n", "ok\n", 0);
+  SIM_Expect("set shunt_lsb 000000000000005000\n", "error: line too long\n",
+             0);
+  SIM_Expect("get shunt_lsb\n", "shunt_lsb 5000\n", 0);
+
+  // Pipelined lines are answered in order, long replies squeeze through a
+  // few bytes of room at a time without losing or cutting a line
+  SIM_Expect("get fast_ms\nget slow_ms\nstream start\n",
+             "fast_ms 2\nslow_ms 140\nok\n", 0);
+  SIM_Expect("help\n", help, 3);
+  SIM_Expect("help\nget\n", "get [name]\n"
+                            "set <name> <value>\n"
+                            "help\n"
+                            "stream start|stop\n"
+                            "output: text binary delta\n"
+                            "shunt_lsb 20..50000\n"
+                            "fast_ms 1..1000\n"
+                            "slow_ms 1..10000\n"
+                            "output binary\n"
+                            "shunt_lsb 5000\n"
+                            "fast_ms 2\n"
+                            "slow_ms 140\n",
+             1);
+
+  if (SIM_Shell.errors != 18) {
+    printf("FAIL %u errors counted instead of 18\n", SIM_Shell.errors);
+    SIM_Failures++;
+  }
+  printf("%u lines, %u errors, %d failed\n", SIM_Shell.lines,
+         SIM_Shell.errors, SIM_Failures);
+  return SIM_Failures != 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc == 2 && strcmp(argv[1], "pty") == 0) {
+    return SIM_Serve();
+  }
+  if (argc == 2 && strcmp(argv[1], "check") == 0) {
+    return SIM_Check();
+  }
+  fprintf(stderr, "usage: %s pty | check\n", argv[0]);
+  return 2;
+}
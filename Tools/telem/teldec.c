@@ -0,0 +1,179 @@
+#include "teldec.h"
+
+#include <string.h>
+
+void TELDEC_Init(TELDEC_Decoder *dec) { memset(dec, 0, sizeof(*dec)); }
+
+int TELDEC_CobsDecode(uint8_t *out, const uint8_t *in, size_t len) {
+  size_t i = 0;
+  int n = 0;
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) {
+      return -1;
+    }
+    for (uint8_t k = 1; k < code; k++) {
+      if (in[i] == 0) {
+        return -1;
+      }
+      out[n++] = in[i++];
+    }
+    // A block shorter than 254 bytes stood for a zero, except the last one
+    if (code < 0xFF && i < len) {
+      out[n++] = 0;
+    }
+  }
+  return n;
+}
+
+int TELDEC_IsReply(const uint8_t *chunk, size_t len) {
+  if (len == 0 || chunk[len - 1] != '\n') {
+    return 0;
+  }
+  for (size_t i = 0; i + 1 < len; i++) {
+    if (chunk[i] < ' ' || chunk[i] > '~') {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static uint32_t TELDEC_Get32(const uint8_t *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Reads a varint of at most 5 bytes. Returns 0 if it runs past end.
+static int TELDEC_Varint(const uint8_t **p, const uint8_t *end,
+                         uint32_t *value) {
+  *value = 0;
+  for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+    uint8_t byte = *(*p)++;
+    *value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int32_t TELDEC_UnZigZag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Expands a delta block, without its CRC, see Inc/telem.h
+static int TELDEC_ParseBlock(const uint8_t *record, size_t len,
+                             TELEM_Sample *samples, TELDEC_Stats *stats) {
+  uint8_t count = record[2];
+  if (len < 12 || count == 0 || count > TELDEC_MAX_SAMPLES) {
+    stats->malformed++;
+    return 0;
+  }
+  samples[0].sequence = record[1];
+  samples[0].time = TELDEC_Get32(record + 3);
+  samples[0].shunt = (int16_t)(record[7] | record[8] << 8);
+  samples[0].bus = record[9] | record[10] << 8;
+  samples[0].flags = record[11];
+  const uint8_t *p = record + 12;
+  const uint8_t *end = record + len;
+  uint32_t interval = 0;
+  for (uint8_t i = 1; i < count; i++) {
+    uint32_t time, shunt, bus;
+    if (!TELDEC_Varint(&p, end, &time) || !TELDEC_Varint(&p, end, &shunt) ||
+        !TELDEC_Varint(&p, end, &bus) || ((shunt & 1) && p == end)) {
+      stats->malformed++;
+      return 0;
+    }
+    TELEM_Sample *sample = &samples[i];
+    *sample = samples[i - 1];
+    interval += TELDEC_UnZigZag(time);
+    sample->time += interval;
+    sample->shunt += TELDEC_UnZigZag(shunt >> 1);
+    sample->bus += TELDEC_UnZigZag(bus);
+    if (shunt & 1) {
+      sample->flags = *p++;
+    }
+    sample->sequence++;
+  }
+  if (p != end) {
+    stats->malformed++;
+    return 0;
+  }
+  stats->blocks++;
+  return count;
+}
+
+int TELDEC_ParseRecord(const uint8_t *record, size_t len,
+                       TELEM_Sample *samples, TELDEC_Stats *stats) {
+  if (len < TELEM_RECORD_SIZE) {
+    stats->truncated++;
+    return 0;
+  }
+  uint16_t crc = record[len - 2] | record[len - 1] << 8;
+  if (TELEM_Crc16(0xFFFF, record, len - 2) != crc) {
+    stats->crc++;
+    return 0;
+  }
+  if (record[0] == TELEM_KIND_BLOCK) {
+    return TELDEC_ParseBlock(record, len - 2, samples, stats);
+  }
+  // Newer versions append fields, the ones of version 1 stay in place
+  if (record[0] == 0 || record[0] >= 0x80) {
+    stats->version++;
+    return 0;
+  }
+  if (record[0] > stats->newest) {
+    stats->newest = record[0];
+  }
+  samples->sequence = record[1];
+  samples->time = TELDEC_Get32(record + 2);
+  samples->shunt = (int16_t)(record[6] | record[7] << 8);
+  samples->bus = record[8] | record[9] << 8;
+  samples->flags = record[10];
+  return 1;
+}
+
+int TELDEC_Push(TELDEC_Decoder *dec, uint8_t byte, TELEM_Sample *samples) {
+  dec->stats.bytes++;
+  if (byte != 0) {
+    if (dec->len < TELDEC_MAX_FRAME) {
+      dec->frame[dec->len++] = byte;
+    } else {
+      dec->overflow = 1;
+    }
+    return 0;
+  }
+
+  // Delimiter: decode what came before it. A capture that starts in the
+  // middle of a frame fails the CRC of the first one.
+  int count = 0;
+  if (dec->overflow) {
+    dec->stats.framing++;
+  } else if (dec->len > 0) {
+    uint8_t record[TELDEC_MAX_FRAME];
+    TELDEC_Stats stats = dec->stats;
+    int len = TELDEC_CobsDecode(record, dec->frame, dec->len);
+    if (len < 0) {
+      stats.framing++;
+    } else {
+      count = TELDEC_ParseRecord(record, len, samples, &stats);
+    }
+    // Only what is not a valid frame can be a reply, a frame may well look
+    // like text
+    if (count == 0 && TELDEC_IsReply(dec->frame, dec->len)) {
+      dec->stats.replies++;
+    } else {
+      dec->stats = stats;
+    }
+  }
+  if (count) {
+    if (dec->started) {
+      dec->stats.lost += (uint8_t)(samples[0].sequence - dec->sequence - 1);
+    }
+    dec->started = 1;
+    dec->sequence = samples[count - 1].sequence;
+    dec->stats.records += count;
+  }
+  dec->overflow = 0;
+  dec->len = 0;
+  return count;
+}
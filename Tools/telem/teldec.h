@@ -0,0 +1,56 @@
+#pragma once
+
+// Host decoder of the binary sample stream of Src/telem.c: splits the byte
+// stream at the 0x00 delimiters, undoes COBS, checks the CRC and the record
+// version, expands delta blocks, and counts everything it drops. Shell reply
+// lines, which the firmware ends with a delimiter as well in binary output,
+// are counted apart from damaged frames.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "telem.h"
+
+// Longest frame kept, anything longer is not a record of a known version and
+// is dropped at its delimiter
+#define TELDEC_MAX_FRAME 256
+// Most samples a frame decodes to
+#define TELDEC_MAX_SAMPLES TELEM_BLOCK_SAMPLES
+
+typedef struct TELDEC_Stats {
+  uint64_t bytes;     // bytes fed
+  uint64_t records;   // samples of valid records and blocks
+  uint64_t blocks;    // valid delta blocks
+  uint64_t lost;      // samples missing from the sequence numbers
+  uint32_t framing;   // frames with a broken COBS code or too long
+  uint32_t truncated; // frames shorter than a record
+  uint32_t crc;       // CRC mismatches
+  uint32_t version;   // records of version 0 or an unknown kind
+  uint32_t malformed; // delta blocks that do not add up despite the CRC
+  uint32_t replies;   // shell reply lines between the frames
+  uint8_t newest;     // highest record version seen
+} TELDEC_Stats;
+
+typedef struct TELDEC_Decoder {
+  uint8_t frame[TELDEC_MAX_FRAME];
+  uint16_t len;
+  uint8_t overflow;  // frame longer than TELDEC_MAX_FRAME, skip to the 0x00
+  uint8_t started;   // a record has been decoded, sequence is valid
+  uint8_t sequence;  // of the last record
+  TELDEC_Stats stats;
+} TELDEC_Decoder;
+
+void TELDEC_Init(TELDEC_Decoder *dec);
+// Feeds one byte. When it completes a valid record or block, writes its
+// samples to samples, which holds TELDEC_MAX_SAMPLES, and returns how many.
+int TELDEC_Push(TELDEC_Decoder *dec, uint8_t byte, TELEM_Sample *samples);
+// Returns 1 if a chunk between delimiters is a line of text, a shell reply
+// rather than a frame.
+int TELDEC_IsReply(const uint8_t *chunk, size_t len);
+// Decodes a COBS frame without its delimiter into out, which needs len bytes.
+// Returns the decoded length, or -1 if the frame is malformed.
+int TELDEC_CobsDecode(uint8_t *out, const uint8_t *in, size_t len);
+// Parses a decoded record or block, CRC included, into samples. Returns the
+// number of samples, 0 if it is not valid.
+int TELDEC_ParseRecord(const uint8_t *record, size_t len,
+                       TELEM_Sample *samples, TELDEC_Stats *stats);
@@ -0,0 +1,828 @@
+// Capture and analysis of the meter's serial output: text reports (see
+// textdec.h) and binary records (see Inc/telem.h) are both decoded from the
+// same stream, from a serial port, a pty or a recorded file.
+//
+// Usage: telemcap capture [options] PORT|FILE
+//          -b RATE     port rate, default 115200
+//          -n RATE     negotiate RATE with the device first, see Inc/baud.h
+//          -l LSB      uA per shunt register LSB, default 5000 as the
+//                      firmware's shunt_lsb
+//          -o FILE     CSV of every sample, - for stdout
+//          -w FILE     columnar binary file, see CAP_Columns
+//          -r FILE     raw copy of the received bytes, for replay and bench
+//          -d SECONDS  stop after this long, otherwise at end of file or ^C
+//        telemcap dump FILE        columnar file as CSV on stdout
+//        telemcap synth FILE [N]   write a binary capture of N samples with
+//                                  steps, noise and a bus voltage change
+//        telemcap bench [FILE]     decode throughput on a capture, on a
+//                                  synthetic one of each format if omitted
+//
+// Live statistics go to stderr once a second: samples per second, current
+// and bus voltage of the last second, energy and charge since the start.
+// Binary records are integrated over their device time stamps. Text reports
+// carry none and are stamped with the host clock on arrival, so the totals of
+// a replayed text capture are meaningless.
+//
+// Build with cmake -S Tools/telem -B build-telem.
+
+#define _DEFAULT_SOURCE
+
+#include "teldec.h"
+#include "textdec.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+
+#define CAP_DEFAULT_RATE 115200
+#define CAP_DEFAULT_LSB 5000
+// Samples further apart are a gap in the capture, not integrated
+#define CAP_MAX_GAP 10000000 // us
+// Rows per block of the columnar file
+#define CAP_BLOCK_ROWS 4096
+#define CAP_READ_SIZE 65536
+
+// One decoded sample, from either format
+typedef struct CAP_Row {
+  int64_t time;     // us, device clock unwrapped, host clock for text
+  int32_t sequence; // of the binary record, -1 for text
+  int32_t shunt;    // uV
+  int32_t bus;      // mV
+  int32_t current;  // uA
+  int64_t power;    // uW
+  uint8_t flags;    // TELEM_FLAG_*, text reports are TELEM_FLAG_REPORT
+} CAP_Row;
+
+// Columnar file: "TCAP", a version byte and the column count, then per column
+// its size in bytes (1 unsigned, 4 or 8 signed) and its NUL-terminated name.
+// Blocks follow, each the row count as uint32 and then every column's values
+// back to back. All little-endian.
+static const struct {
+  const char *name;
+  uint8_t size;
+  size_t offset;
+} CAP_Columns[] = {
+    {"time_us", 8, offsetof(CAP_Row, time)},
+    {"sequence", 4, offsetof(CAP_Row, sequence)},
+    {"shunt_uv", 4, offsetof(CAP_Row, shunt)},
+    {"bus_mv", 4, offsetof(CAP_Row, bus)},
+    {"current_ua", 4, offsetof(CAP_Row, current)},
+    {"power_uw", 8, offsetof(CAP_Row, power)},
+    {"flags", 1, offsetof(CAP_Row, flags)},
+};
+#define CAP_COLUMN_COUNT (sizeof(CAP_Columns) / sizeof(CAP_Columns[0]))
+#define CAP_FILE_VERSION 1
+
+typedef struct CAP_ColumnFile {
+  FILE *file;
+  uint32_t rows; // in the current block
+  uint8_t data[CAP_COLUMN_COUNT][CAP_BLOCK_ROWS * 8];
+} CAP_ColumnFile;
+
+typedef struct CAP_Totals {
+  uint64_t samples;
+  double energy; // J
+  double charge; // C
+  CAP_Row last;  // previous sample, the rectangle integrated up to the next
+  // Since the last live line
+  uint64_t count;
+  double currentSum; // uA
+  double busSum;     // mV
+  int32_t min;       // uA
+  int32_t max;
+} CAP_Totals;
+
+typedef struct CAP_Capture {
+  TELDEC_Decoder binary;
+  TXTDEC_Decoder text;
+  int32_t lsb;       // uA per shunt LSB
+  uint32_t lastTime; // device time of the last record
+  int64_t time;      // the same, unwrapped
+  uint8_t timed;     // a record has set the time
+  FILE *csv;
+  CAP_ColumnFile *columns;
+  CAP_Totals totals;
+} CAP_Capture;
+
+static volatile sig_atomic_t CAP_Stop;
+
+static int64_t CAP_Now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ---------------------------------------------------------------------------
+// Output
+
+static void CAP_WriteLE(uint8_t *out, int64_t value, uint8_t size) {
+  for (uint8_t i = 0; i < size; i++) {
+    out[i] = (uint64_t)value >> (8 * i);
+  }
+}
+
+static int64_t CAP_ReadLE(const uint8_t *in, uint8_t size) {
+  uint64_t value = 0;
+  for (uint8_t i = 0; i < size; i++) {
+    value |= (uint64_t)in[i] << (8 * i);
+  }
+  // Sign-extend all but the unsigned byte columns
+  if (size > 1 && size < 8 && (value >> (8 * size - 1))) {
+    value |= ~(uint64_t)0 << (8 * size);
+  }
+  return (int64_t)value;
+}
+
+static int64_t CAP_Field(const CAP_Row *row, size_t column) {
+  const char *p = (const char *)row + CAP_Columns[column].offset;
+  switch (CAP_Columns[column].size) {
+  case 1:
+    return *(const uint8_t *)p;
+  case 4:
+    return *(const int32_t *)p;
+  default:
+    return *(const int64_t *)p;
+  }
+}
+
+static CAP_ColumnFile *CAP_OpenColumns(const char *path) {
+  CAP_ColumnFile *out = calloc(1, sizeof(*out));
+  out->file = fopen(path, "wb");
+  if (out->file == NULL) {
+    perror(path);
+    exit(1);
+  }
+  fwrite("TCAP", 1, 4, out->file);
+  fputc(CAP_FILE_VERSION, out->file);
+  fputc(CAP_COLUMN_COUNT, out->file);
+  for (size_t c = 0; c < CAP_COLUMN_COUNT; c++) {
+    fputc(CAP_Columns[c].size, out->file);
+    fwrite(CAP_Columns[c].name, 1, strlen(CAP_Columns[c].name) + 1, out->file);
+  }
+  return out;
+}
+
+static void CAP_FlushColumns(CAP_ColumnFile *out) {
+  if (out->rows == 0) {
+    return;
+  }
+  uint8_t count[4];
+  CAP_WriteLE(count, out->rows, 4);
+  fwrite(count, 1, 4, out->file);
+  for (size_t c = 0; c < CAP_COLUMN_COUNT; c++) {
+    fwrite(out->data[c], CAP_Columns[c].size, out->rows, out->file);
+  }
+  out->rows = 0;
+}
+
+static void CAP_AddColumns(CAP_ColumnFile *out, const CAP_Row *row) {
+  for (size_t c = 0; c < CAP_COLUMN_COUNT; c++) {
+    uint8_t size = CAP_Columns[c].size;
+    CAP_WriteLE(&out->data[c][out->rows * size], CAP_Field(row, c), size);
+  }
+  if (++out->rows == CAP_BLOCK_ROWS) {
+    CAP_FlushColumns(out);
+  }
+}
+
+static void CAP_CloseColumns(CAP_ColumnFile *out) {
+  CAP_FlushColumns(out);
+  fclose(out->file);
+  free(out);
+}
+
+static void CAP_PrintHeader(FILE *csv) {
+  for (size_t c = 0; c < CAP_COLUMN_COUNT; c++) {
+    fprintf(csv, c ? ",%s" : "%s", CAP_Columns[c].name);
+  }
+  fputc('\n', csv);
+}
+
+static void CAP_PrintRow(FILE *csv, const CAP_Row *row) {
+  fprintf(csv, "%lld,%d,%d,%d,%d,%lld,%u\n", (long long)row->time,
+          row->sequence, row->shunt, row->bus, row->current,
+          (long long)row->power, row->flags);
+}
+
+// ---------------------------------------------------------------------------
+// Decoding and statistics
+
+static void CAP_Init(CAP_Capture *cap, int32_t lsb) {
+  memset(cap, 0, sizeof(*cap));
+  TELDEC_Init(&cap->binary);
+  TXTDEC_Init(&cap->text);
+  cap->lsb = lsb;
+}
+
+static void CAP_AddRow(CAP_Capture *cap, const CAP_Row *row) {
+  CAP_Totals *totals = &cap->totals;
+  if (totals->samples > 0) {
+    int64_t dt = row->time - totals->last.time;
+    if (dt > 0 && dt <= CAP_MAX_GAP) {
+      totals->energy += totals->last.power * 1e-12 * dt;
+      totals->charge += totals->last.current * 1e-12 * dt;
+    }
+  }
+  totals->last = *row;
+  totals->samples++;
+  if (totals->count == 0 || row->current < totals->min) {
+    totals->min = row->current;
+  }
+  if (totals->count == 0 || row->current > totals->max) {
+    totals->max = row->current;
+  }
+  totals->count++;
+  totals->currentSum += row->current;
+  totals->busSum += row->bus;
+
+  if (cap->csv) {
+    CAP_PrintRow(cap->csv, row);
+  }
+  if (cap->columns) {
+    CAP_AddColumns(cap->columns, row);
+  }
+}
+
+// Feeds received bytes to both decoders, now stamps text reports
+static void CAP_Feed(CAP_Capture *cap, const uint8_t *data, size_t len,
+                     int64_t now) {
+  TELEM_Sample samples[TELDEC_MAX_SAMPLES];
+  TXTDEC_Report report;
+  CAP_Row row;
+  for (size_t i = 0; i < len; i++) {
+    int count = TELDEC_Push(&cap->binary, data[i], samples);
+    for (int k = 0; k < count; k++) {
+      const TELEM_Sample *sample = &samples[k];
+      if (!cap->timed) {
+        cap->time = sample->time;
+        cap->timed = 1;
+      } else {
+        cap->time += (uint32_t)(sample->time - cap->lastTime);
+      }
+      cap->lastTime = sample->time;
+      row.time = cap->time;
+      row.sequence = sample->sequence;
+      row.shunt = sample->shunt * 10;
+      row.bus = sample->bus * 4;
+      row.current = sample->shunt * cap->lsb;
+      row.power = (int64_t)row.current * row.bus / 1000;
+      row.flags = sample->flags;
+      CAP_AddRow(cap, &row);
+    }
+    if (TXTDEC_Push(&cap->text, data[i], &report)) {
+      row.time = now;
+      row.sequence = -1;
+      row.shunt = report.shunt;
+      row.bus = report.bus;
+      row.current = report.current * 1000;
+      row.power = (int64_t)row.current * row.bus / 1000;
+      row.flags = TELEM_FLAG_REPORT;
+      CAP_AddRow(cap, &row);
+    }
+  }
+}
+
+static void CAP_PrintLive(CAP_Capture *cap, double seconds, double elapsed) {
+  CAP_Totals *totals = &cap->totals;
+  fprintf(stderr, "%7.1f s  %6.0f/s", seconds, totals->count / elapsed);
+  if (totals->count) {
+    fprintf(stderr, "  I %.3f mA (%.3f..%.3f)  V %.3f",
+            totals->currentSum / totals->count / 1000, totals->min / 1000.0,
+            totals->max / 1000.0, totals->busSum / totals->count / 1000);
+  }
+  fprintf(stderr, "  E %.4f mWh  Q %.4f mAh  lost %llu  bad %u\n",
+          totals->energy / 3.6, totals->charge / 3.6,
+          (unsigned long long)cap->binary.stats.lost,
+          cap->binary.stats.framing + cap->binary.stats.truncated +
+              cap->binary.stats.crc);
+  totals->count = 0;
+  totals->currentSum = 0;
+  totals->busSum = 0;
+}
+
+static void CAP_PrintSummary(const CAP_Capture *cap) {
+  const TELDEC_Stats *bin = &cap->binary.stats;
+  const TXTDEC_Stats *text = &cap->text.stats;
+  fprintf(stderr, "%llu samples, %.4f mWh, %.4f mAh\n",
+          (unsigned long long)cap->totals.samples, cap->totals.energy / 3.6,
+          cap->totals.charge / 3.6);
+  if (bin->records) {
+    fprintf(stderr,
+            "binary: %llu samples, %llu delta blocks, %llu lost, %u framing, "
+            "%u truncated, %u crc, %u bad version, %u malformed, "
+            "%u replies\n",
+            (unsigned long long)bin->records, (unsigned long long)bin->blocks,
+            (unsigned long long)bin->lost, bin->framing, bin->truncated,
+            bin->crc, bin->version, bin->malformed, bin->replies);
+  }
+  if (text->reports) {
+    fprintf(stderr,
+            "text: %llu reports, %llu other lines, %u partial, %u malformed, "
+            "%u overlong",
+            (unsigned long long)text->reports,
+            (unsigned long long)text->other, text->partial, text->malformed,
+            text->overlong);
+    if (cap->text.energy >= 0) {
+      fprintf(stderr, ", device total %d mWh", cap->text.energy);
+    }
+    fputc('\n', stderr);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Serial port
+
+static const struct {
+  uint32_t rate;
+  speed_t speed;
+} CAP_Speeds[] = {
+    {9600, B9600},       {19200, B19200},     {38400, B38400},
+    {57600, B57600},     {115200, B115200},   {230400, B230400},
+    {460800, B460800},   {500000, B500000},   {576000, B576000},
+    {921600, B921600},   {1000000, B1000000}, {1152000, B1152000},
+    {1500000, B1500000}, {2000000, B2000000}, {3000000, B3000000},
+};
+
+static int CAP_SetRate(int fd, uint32_t rate) {
+  struct termios tio;
+  for (size_t i = 0; i < sizeof(CAP_Speeds) / sizeof(CAP_Speeds[0]); i++) {
+    if (CAP_Speeds[i].rate == rate) {
+      if (tcgetattr(fd, &tio)) {
+        return -1;
+      }
+      cfsetispeed(&tio, CAP_Speeds[i].speed);
+      cfsetospeed(&tio, CAP_Speeds[i].speed);
+      return tcsetattr(fd, TCSANOW, &tio);
+    }
+  }
+  errno = EINVAL;
+  return -1;
+}
+
+// Opens a port in raw mode, or a file for replay
+static int CAP_Open(const char *path, uint32_t rate) {
+  int fd = open(path, O_RDWR | O_NOCTTY);
+  if (fd < 0) {
+    fd = open(path, O_RDONLY);
+  }
+  if (fd < 0) {
+    perror(path);
+    exit(1);
+  }
+  if (!isatty(fd)) {
+    return fd;
+  }
+  struct termios tio;
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  tcsetattr(fd, TCSANOW, &tio);
+  if (CAP_SetRate(fd, rate)) {
+    fprintf(stderr, "%s: rate %u not supported\n", path, rate);
+    exit(1);
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+static void CAP_Send(int fd, const char *text) {
+  if (write(fd, text, strlen(text)) != (ssize_t)strlen(text)) {
+    perror("write");
+  }
+}
+
+// Reads lines until one contains one of the two texts or timeout ms passed.
+// The device may stream meanwhile, binary frames included. Returns 1 or 2
+// for the text found, 0 on timeout.
+static int CAP_WaitFor(int fd, const char *text, const char *other,
+                       int timeout) {
+  char line[256];
+  size_t len = 0;
+  int64_t end = CAP_Now() + timeout * 1000LL;
+  while (CAP_Now() < end) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    uint8_t byte;
+    if (poll(&pfd, 1, 10) <= 0 || read(fd, &byte, 1) != 1) {
+      continue;
+    }
+    if (byte != '\n' && byte != 0) {
+      if (len < sizeof(line) - 1) {
+        line[len++] = byte;
+      }
+      continue;
+    }
+    line[len] = '\0';
+    len = 0;
+    if (strstr(line, text)) {
+      return 1;
+    }
+    if (other && strstr(line, other)) {
+      return 2;
+    }
+  }
+  return 0;
+}
+
+// The handshake of Inc/baud.h. Returns the rate the link ends up at.
+static uint32_t CAP_Negotiate(int fd, uint32_t from, uint32_t to) {
+  char command[32], answer[32];
+  if (CAP_SetRate(fd, to)) {
+    fprintf(stderr, "baud: %u not supported by the port\n", to);
+    CAP_SetRate(fd, from);
+    return from;
+  }
+  CAP_SetRate(fd, from);
+  // A leading line end finishes whatever the shell has half received
+  snprintf(command, sizeof(command), "\nbaud %u\n", to);
+  snprintf(answer, sizeof(answer), "baud %u actual", to);
+  CAP_Send(fd, command);
+  int found = CAP_WaitFor(fd, answer, "baud refused", 1000);
+  if (found != 1) {
+    fprintf(stderr, "baud: %u %s\n", to, found ? "refused" : "not answered");
+    return from;
+  }
+  // The device switches once its answer is out, give its main loop a moment
+  tcdrain(fd);
+  CAP_SetRate(fd, to);
+  usleep(20000);
+  tcflush(fd, TCIFLUSH);
+  snprintf(answer, sizeof(answer), "baud ok %u", to);
+  for (int tries = 0; tries < 5; tries++) {
+    CAP_Send(fd, "\nbaud ok\n");
+    if (CAP_WaitFor(fd, answer, NULL, 150)) {
+      fprintf(stderr, "baud: %u\n", to);
+      return to;
+    }
+  }
+  // The device falls back on its own
+  CAP_SetRate(fd, from);
+  CAP_WaitFor(fd, "baud fallback", NULL, 1000);
+  fprintf(stderr, "baud: %u failed, staying at %u\n", to, from);
+  return from;
+}
+
+static void CAP_PrintPortErrors(int fd) {
+#ifdef TIOCGICOUNT
+  struct serial_icounter_struct count;
+  if (ioctl(fd, TIOCGICOUNT, &count) == 0) {
+    fprintf(stderr, "port: %d overrun, %d buffer overrun, %d framing\n",
+            count.overrun, count.buf_overrun, count.frame);
+  }
+#endif
+}
+
+static void CAP_Interrupt(int signal) { CAP_Stop = 1; }
+
+static int CAP_Run(int argc, char **argv) {
+  uint32_t rate = CAP_DEFAULT_RATE, negotiate = 0;
+  int32_t lsb = CAP_DEFAULT_LSB;
+  double duration = 0;
+  const char *csvPath = NULL, *columnPath = NULL, *rawPath = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:n:l:o:w:r:d:")) != -1) {
+    switch (opt) {
+    case 'b':
+      rate = strtoul(optarg, NULL, 10);
+      break;
+    case 'n':
+      negotiate = strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      lsb = strtol(optarg, NULL, 10);
+      break;
+    case 'o':
+      csvPath = optarg;
+      break;
+    case 'w':
+      columnPath = optarg;
+      break;
+    case 'r':
+      rawPath = optarg;
+      break;
+    case 'd':
+      duration = strtod(optarg, NULL);
+      break;
+    default:
+      return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "capture: PORT or FILE missing\n");
+    return 2;
+  }
+
+  static CAP_Capture cap;
+  CAP_Init(&cap, lsb);
+  int fd = CAP_Open(argv[optind], rate);
+  int live = isatty(fd);
+  if (live && negotiate) {
+    rate = CAP_Negotiate(fd, rate, negotiate);
+  }
+  if (csvPath) {
+    cap.csv = strcmp(csvPath, "-") == 0 ? stdout : fopen(csvPath, "w");
+    if (cap.csv == NULL) {
+      perror(csvPath);
+      return 1;
+    }
+    setvbuf(cap.csv, NULL, _IOFBF, 1 << 20);
+    CAP_PrintHeader(cap.csv);
+  }
+  if (columnPath) {
+    cap.columns = CAP_OpenColumns(columnPath);
+  }
+  FILE *raw = NULL;
+  if (rawPath && (raw = fopen(rawPath, "wb")) == NULL) {
+    perror(rawPath);
+    return 1;
+  }
+  signal(SIGINT, CAP_Interrupt);
+  signal(SIGTERM, CAP_Interrupt);
+
+  static uint8_t buf[CAP_READ_SIZE];
+  int64_t start = CAP_Now(), lastLive = start;
+  while (!CAP_Stop) {
+    int64_t now = CAP_Now();
+    if (duration > 0 && now - start >= duration * 1e6) {
+      break;
+    }
+    if (live) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      poll(&pfd, 1, 100);
+    }
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) {
+      now = CAP_Now();
+      if (raw) {
+        fwrite(buf, 1, n, raw);
+      }
+      CAP_Feed(&cap, buf, n, now);
+    } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+      // End of the file, or the other side of a pty went away
+      break;
+    }
+    if (live && now - lastLive >= 1000000) {
+      CAP_PrintLive(&cap, (now - start) / 1e6, (now - lastLive) / 1e6);
+      lastLive = now;
+    }
+  }
+
+  if (live) {
+    CAP_PrintPortErrors(fd);
+  }
+  CAP_PrintSummary(&cap);
+  close(fd);
+  if (raw) {
+    fclose(raw);
+  }
+  if (cap.csv && cap.csv != stdout) {
+    fclose(cap.csv);
+  } else if (cap.csv) {
+    fflush(stdout);
+  }
+  if (cap.columns) {
+    CAP_CloseColumns(cap.columns);
+  }
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Columnar file to CSV
+
+static int CAP_Dump(const char *path) {
+  FILE *in = fopen(path, "rb");
+  if (in == NULL) {
+    perror(path);
+    return 1;
+  }
+  uint8_t head[6];
+  if (fread(head, 1, 6, in) != 6 || memcmp(head, "TCAP", 4) != 0 ||
+      head[4] != CAP_FILE_VERSION || head[5] > 32) {
+    fprintf(stderr, "%s: not a capture of version %d\n", path,
+            CAP_FILE_VERSION);
+    return 1;
+  }
+  uint8_t columns = head[5], sizes[32];
+  for (uint8_t c = 0; c < columns; c++) {
+    int ch;
+    sizes[c] = fgetc(in);
+    if (sizes[c] != 1 && sizes[c] != 4 && sizes[c] != 8) {
+      fprintf(stderr, "%s: bad column size\n", path);
+      return 1;
+    }
+    fputs(c ? "," : "", stdout);
+    while ((ch = fgetc(in)) > 0) {
+      putchar(ch);
+    }
+  }
+  putchar('\n');
+
+  // Columns in the file this tool does not know are printed all the same
+  static uint8_t block[32][CAP_BLOCK_ROWS * 8];
+  uint8_t count[4];
+  while (fread(count, 1, 4, in) == 4) {
+    uint32_t rows = CAP_ReadLE(count, 4);
+    if (rows > CAP_BLOCK_ROWS) {
+      fprintf(stderr, "%s: block of %u rows\n", path, rows);
+      return 1;
+    }
+    for (uint8_t c = 0; c < columns; c++) {
+      if (fread(block[c], sizes[c], rows, in) != rows) {
+        fprintf(stderr, "%s: truncated\n", path);
+        return 1;
+      }
+    }
+    for (uint32_t r = 0; r < rows; r++) {
+      for (uint8_t c = 0; c < columns; c++) {
+        int64_t value = CAP_ReadLE(&block[c][r * sizes[c]], sizes[c]);
+        printf(c ? ",%lld" : "%lld", (long long)value);
+      }
+      putchar('\n');
+    }
+  }
+  fclose(in);
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic captures and throughput
+
+static uint32_t CAP_Seed = 1;
+
+static uint32_t CAP_Random(uint32_t range) {
+  CAP_Seed = CAP_Seed * 1664525 + 1013904223;
+  return (CAP_Seed >> 8) % range;
+}
+
+// Next sample of a load that idles, steps and draws pulses, sampled fast at
+// 2 ms like the firmware's fast mode. The bus goes from 5 to 9 V halfway.
+static void CAP_NextSample(TELEM_Sample *sample, uint32_t i, uint32_t count) {
+  static int32_t level = 100;
+  if (CAP_Random(500) == 0) {
+    level = CAP_Random(800);
+  }
+  int32_t shunt = level + (int32_t)CAP_Random(7) - 3;
+  if (i % 50 < 5) {
+    shunt += 60;
+  }
+  sample->time += 2000 + CAP_Random(20);
+  sample->shunt = shunt;
+  sample->bus = (i < count / 2 ? 1250 : 2250) + CAP_Random(3);
+  sample->flags = TELEM_FLAG_FAST | (i % 8 == 7 ? TELEM_FLAG_REPORT : 0);
+  sample->sequence = i;
+}
+
+// Records, or delta blocks as the firmware's "delta" output sends them
+static uint8_t *CAP_SynthBinary(uint32_t count, int blocks, size_t *size) {
+  uint8_t *out = malloc((size_t)count * TELEM_FRAME_SIZE);
+  TELEM_Sample sample = {0};
+  static TELEM_Block block;
+  TELEM_InitBlock(&block);
+  *size = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    CAP_NextSample(&sample, i, count);
+    if (!blocks) {
+      *size += TELEM_EncodeSample(out + *size, &sample);
+    } else if (TELEM_AddSample(&block, &sample, 2000)) {
+      *size += TELEM_EncodeBlock(out + *size, &block);
+    }
+  }
+  *size += TELEM_EncodeBlock(out + *size, &block);
+  return out;
+}
+
+// The same load as text reports
+static uint8_t *CAP_SynthText(uint32_t count, size_t *size) {
+  size_t capacity = (size_t)count * 200;
+  char *out = malloc(capacity);
+  TELEM_Sample sample = {0};
+  *size = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    CAP_NextSample(&sample, i, count);
+    int32_t current = sample.shunt * 5;
+    *size += snprintf(out + *size, capacity - *size,
+                      "Shunt Voltage: %d uV\nBus Voltage: %d mV\n"
+                      "Current: %d mA\nPower: %d mW\nEnergy: %u mWh\n\n",
+                      sample.shunt * 10, sample.bus * 4, current,
+                      current * sample.bus * 4 / 1000, i / 100);
+  }
+  return (uint8_t *)out;
+}
+
+static int CAP_Synth(const char *path, uint32_t count) {
+  size_t size;
+  uint8_t *data = CAP_SynthBinary(count, 0, &size);
+  FILE *out = fopen(path, "wb");
+  if (out == NULL) {
+    perror(path);
+    return 1;
+  }
+  fwrite(data, 1, size, out);
+  fclose(out);
+  free(data);
+  fprintf(stderr, "%u samples, %zu bytes\n", count, size);
+  return 0;
+}
+
+// Decodes the capture repeatedly for half a second into each kind of output
+static void CAP_BenchOne(const char *name, const uint8_t *data, size_t size) {
+  static const char *const outputs[] = {"decode", "csv", "columns"};
+  FILE *null = fopen("/dev/null", "w");
+  setvbuf(null, NULL, _IOFBF, 1 << 20);
+  for (int mode = 0; mode < 3; mode++) {
+    static CAP_Capture cap;
+    uint64_t bytes = 0, samples = 0;
+    int64_t start = CAP_Now(), elapsed;
+    do {
+      CAP_Init(&cap, CAP_DEFAULT_LSB);
+      cap.csv = mode == 1 ? null : NULL;
+      if (mode == 2) {
+        cap.columns = CAP_OpenColumns("/dev/null");
+      }
+      // Fed in read-sized pieces, as from the port
+      for (size_t at = 0; at < size; at += CAP_READ_SIZE) {
+        size_t n = size - at < CAP_READ_SIZE ? size - at : CAP_READ_SIZE;
+        CAP_Feed(&cap, data + at, n, 0);
+      }
+      if (cap.columns) {
+        CAP_CloseColumns(cap.columns);
+      }
+      bytes += size;
+      samples += cap.totals.samples;
+      elapsed = CAP_Now() - start;
+    } while (elapsed < 500000);
+    double seconds = elapsed / 1e6;
+    // 10 bits per byte on the wire, 8N1
+    printf("%-7s %-8s %8.1f MB/s %8.2f M samples/s  %6.0fx 1.5 Mbaud\n",
+           name, outputs[mode], bytes / seconds / 1e6, samples / seconds / 1e6,
+           bytes * 10 / seconds / 1.5e6);
+  }
+  fclose(null);
+}
+
+static int CAP_Bench(const char *path) {
+  if (path) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+      perror(path);
+      return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    size_t size = ftell(in);
+    rewind(in);
+    uint8_t *data = malloc(size ? size : 1);
+    if (fread(data, 1, size, in) != size) {
+      perror(path);
+      return 1;
+    }
+    fclose(in);
+    CAP_BenchOne("capture", data, size);
+    free(data);
+    return 0;
+  }
+  size_t size;
+  uint8_t *data = CAP_SynthBinary(1000000, 0, &size);
+  CAP_BenchOne("binary", data, size);
+  free(data);
+  data = CAP_SynthBinary(1000000, 1, &size);
+  CAP_BenchOne("delta", data, size);
+  free(data);
+  data = CAP_SynthText(100000, &size);
+  CAP_BenchOne("text", data, size);
+  free(data);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && strcmp(argv[1], "capture") == 0) {
+    return CAP_Run(argc - 1, argv + 1);
+  }
+  if (argc == 3 && strcmp(argv[1], "dump") == 0) {
+    return CAP_Dump(argv[2]);
+  }
+  if ((argc == 3 || argc == 4) && strcmp(argv[1], "synth") == 0) {
+    return CAP_Synth(argv[2], argc == 4 ? strtoul(argv[3], NULL, 10) : 100000);
+  }
+  if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench") == 0) {
+    return CAP_Bench(argc == 3 ? argv[2] : NULL);
+  }
+  fprintf(stderr,
+          "usage: %s capture [-b RATE] [-n RATE] [-l LSB] [-o CSV] "
+          "[-w COLUMNS] [-r RAW] [-d SECONDS] PORT|FILE\n"
+          "       %s dump COLUMNS | synth FILE [N] | bench [FILE]\n",
+          argv[0], argv[0]);
+  return 2;
+}
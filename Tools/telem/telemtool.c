@@ -0,0 +1,410 @@
+// Host side of the binary sample stream, see Inc/telem.h.
+//
+// Usage: telemtool decode [FILE]  decode a capture (stdin if omitted) to CSV
+//                                 on stdout, drop counts on stderr
+//        telemtool check          round-trip the firmware encoder through the
+//                                 decoder, with damaged frames, and the
+//                                 committed synth-capture.bin through delta
+//                                 blocks, exit 1 on any mismatch
+//        telemtool roundtrip FILE [OUT]
+//                                 pack the records of a capture into delta
+//                                 blocks, decode them again and compare, exit
+//                                 1 on any difference; OUT gets the packed
+//                                 stream
+//
+// Build with cmake -S Tools/telem -B build-telem. The encoder is the firmware's
+// own Src/telem.c.
+
+#include "teldec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void TOOL_PrintStats(const TELDEC_Stats *stats) {
+  fprintf(stderr,
+          "%llu bytes, %llu samples (version %u, %llu blocks), %llu lost, "
+          "%u framing, %u truncated, %u crc, %u bad version, %u malformed, "
+          "%u replies\n",
+          (unsigned long long)stats->bytes, (unsigned long long)stats->records,
+          stats->newest, (unsigned long long)stats->blocks,
+          (unsigned long long)stats->lost, stats->framing, stats->truncated,
+          stats->crc, stats->version, stats->malformed, stats->replies);
+}
+
+static int TOOL_Decode(const char *path) {
+  FILE *in = path ? fopen(path, "rb") : stdin;
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+  TELDEC_Decoder dec;
+  TELEM_Sample samples[TELDEC_MAX_SAMPLES];
+  uint8_t buf[4096];
+  size_t n;
+  TELDEC_Init(&dec);
+  printf("sequence,time_us,shunt_uv,bus_mv,flags\n");
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    for (size_t i = 0; i < n; i++) {
+      int count = TELDEC_Push(&dec, buf[i], samples);
+      for (int k = 0; k < count; k++) {
+        const TELEM_Sample *sample = &samples[k];
+        printf("%u,%u,%d,%u,0x%02X\n", sample->sequence, sample->time,
+               sample->shunt * 10, sample->bus * 4u, sample->flags);
+      }
+    }
+  }
+  if (path) {
+    fclose(in);
+  }
+  TOOL_PrintStats(&dec.stats);
+  return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Round-trip checks
+
+static uint32_t TOOL_Seed = 1;
+
+static uint32_t TOOL_Random(uint32_t range) {
+  TOOL_Seed = TOOL_Seed * 1664525 + 1013904223;
+  return (TOOL_Seed >> 8) % range;
+}
+
+static int TOOL_Failures;
+
+static void TOOL_Expect(int ok, const char *what) {
+  if (!ok) {
+    printf("FAIL %s\n", what);
+    TOOL_Failures++;
+  }
+}
+
+static void TOOL_CheckCrc(void) {
+  // Check value of CRC-16/CCITT-FALSE
+  TOOL_Expect(TELEM_Crc16(0xFFFF, (const uint8_t *)"123456789", 9) == 0x29B1,
+              "crc check value");
+}
+
+static void TOOL_CheckCobs(void) {
+  static uint8_t in[1024], frame[1100], out[1100];
+  for (int run = 0; run < 20000; run++) {
+    // Zero-free runs around the 254 byte block limit as well as short ones
+    uint16_t len = TOOL_Random(run % 2 ? 600 : 20);
+    uint32_t zeros = TOOL_Random(4) == 0 ? 0 : 1 + TOOL_Random(40);
+    for (uint16_t i = 0; i < len; i++) {
+      in[i] = zeros && TOOL_Random(zeros) == 0 ? 0 : 1 + TOOL_Random(255);
+    }
+    uint16_t n = TELEM_CobsEncode(frame, in, len);
+    int ok = n <= len + len / 254 + 2 && frame[n - 1] == 0 &&
+             memchr(frame, 0, n - 1) == NULL;
+    int back = TELDEC_CobsDecode(out, frame, n - 1);
+    ok = ok && back == len && memcmp(in, out, len) == 0;
+    if (!ok) {
+      printf("FAIL cobs round trip, %u bytes\n", len);
+      TOOL_Failures++;
+      return;
+    }
+  }
+}
+
+#define TOOL_SAMPLES 100000
+
+static int TOOL_SameSample(const TELEM_Sample *a, const TELEM_Sample *b) {
+  return a->time == b->time && a->shunt == b->shunt && a->bus == b->bus &&
+         a->flags == b->flags && a->sequence == b->sequence;
+}
+
+// Shell replies as the firmware sends them between frames, see
+// APP_ShellWrite
+static const char *const TOOL_Replies[] = {
+    "ok\n", "output delta\n", "fast_ms: 1..1000\n",
+    "error: unknown command, try help\n", "  stream start|stop\n"};
+
+// Encodes random samples into one stream, as records or as delta blocks,
+// damages some frames, puts shell replies between some, and checks that the
+// decoder returns exactly the samples of the undamaged ones
+static void TOOL_CheckStream(int blocks) {
+  static TELEM_Sample sent[TOOL_SAMPLES];
+  static uint8_t damaged[TOOL_SAMPLES];
+  static uint8_t stream[TOOL_SAMPLES * (TELEM_FRAME_SIZE + 1)];
+  static TELEM_Block block;
+  size_t size = 0;
+  // Wraps around during the run
+  uint32_t time = 0xFFF00000;
+  int16_t shunt = 0;
+  uint16_t bus = 1250;
+  int longest = 0;
+  uint32_t replies = 0;
+  uint32_t held = 0; // longest a keyframe waited for its block to close
+
+  for (int i = 0; i < TOOL_SAMPLES; i++) {
+    TELEM_Sample *s = &sent[i];
+    // Mostly small steps at a steady rate, with the extremes of every field
+    // now and then
+    time += TOOL_Random(20) ? 1990 + TOOL_Random(20) : TOOL_Random(1 << 24);
+    shunt += TOOL_Random(21) - 10;
+    bus += TOOL_Random(5) - 2;
+    s->time = time;
+    s->shunt = TOOL_Random(100) ? shunt : (int16_t)(TOOL_Random(2) ? 32767 : -32768);
+    s->bus = TOOL_Random(100) ? bus : TOOL_Random(2) ? 0 : 0xFFFF;
+    s->flags = TOOL_Random(8) ? 0x01 : TOOL_Random(256);
+    s->sequence = i;
+  }
+
+  // Tail of a frame sent before the capture started, must be dropped
+  stream[size++] = 0x05;
+  stream[size++] = 0x12;
+  stream[size++] = 0x00;
+  TELEM_InitBlock(&block);
+  int merge = 0; // the previous frame lost its delimiter
+  for (int i = 0; i < TOOL_SAMPLES;) {
+    int first = i;
+    uint8_t frame[TELEM_BLOCK_FRAME_SIZE];
+    uint8_t n;
+    if (blocks) {
+      // The firmware knows its next interval, here it is the real one
+      while (i < TOOL_SAMPLES) {
+        uint32_t next = i + 1 < TOOL_SAMPLES ? sent[i + 1].time - sent[i].time
+                                             : 0;
+        if (TELEM_AddSample(&block, &sent[i++], next)) {
+          break;
+        }
+      }
+      if (block.last.time - block.start > held) {
+        held = block.last.time - block.start;
+      }
+      n = TELEM_EncodeBlock(frame, &block);
+    } else {
+      n = TELEM_EncodeSample(frame, &sent[i++]);
+    }
+    if (n > longest) {
+      longest = n;
+    }
+    // A reply right after a frame that lost its delimiter would only end
+    // that frame early
+    if (!merge && TOOL_Random(50) == 0) {
+      const char *reply = TOOL_Replies[TOOL_Random(5)];
+      size_t len = strlen(reply);
+      memcpy(stream + size, reply, len + 1);
+      size += len + 1;
+      replies++;
+    }
+    int damage = merge;
+    merge = 0;
+    switch (TOOL_Random(50)) {
+    case 0: // flipped bit
+      frame[TOOL_Random(n - 1)] ^= 1 << TOOL_Random(8);
+      damage = 1;
+      break;
+    case 1: { // lost byte
+      uint8_t at = TOOL_Random(n - 1);
+      memmove(frame + at, frame + at + 1, n - at - 1);
+      n--;
+      damage = 1;
+      break;
+    }
+    case 2: // lost delimiter, merges with the next frame
+      n--;
+      damage = merge = 1;
+      break;
+    }
+    memset(damaged + first, damage, i - first);
+    memcpy(stream + size, frame, n);
+    size += n;
+  }
+
+  TELDEC_Decoder dec;
+  TELEM_Sample got[TELDEC_MAX_SAMPLES];
+  int next = 0;
+  int wrong = 0;
+  int expected = 0;
+  TELDEC_Init(&dec);
+  int last = TOOL_SAMPLES - 1;
+  for (int i = 0; i < TOOL_SAMPLES; i++) {
+    expected += !damaged[i];
+  }
+  // Damaged records at the end leave no gap in the sequence numbers
+  while (damaged[last]) {
+    last--;
+  }
+  for (size_t i = 0; i < size; i++) {
+    int count = TELDEC_Push(&dec, stream[i], got);
+    for (int k = 0; k < count; k++) {
+      while (next < TOOL_SAMPLES && damaged[next]) {
+        next++;
+      }
+      if (next == TOOL_SAMPLES || !TOOL_SameSample(&got[k], &sent[next])) {
+        wrong++;
+      }
+      next++;
+    }
+  }
+  TOOL_Expect(wrong == 0, "stream samples match");
+  TOOL_Expect(dec.stats.records == (uint64_t)expected, "stream sample count");
+  TOOL_Expect(dec.stats.lost == (uint64_t)(last + 1 - expected),
+              "stream lost count");
+  TOOL_Expect(dec.stats.malformed == 0, "no malformed blocks");
+  TOOL_Expect(dec.stats.replies == replies, "shell replies between frames");
+  TOOL_Expect(longest <= (blocks ? TELEM_BLOCK_FRAME_SIZE : TELEM_FRAME_SIZE),
+              "frame size limit");
+  TOOL_Expect(held <= TELEM_BLOCK_TIME, "block latency");
+  fprintf(stderr, "%s: %.2f bytes per sample, longest frame %d bytes\n",
+          blocks ? "blocks" : "records", (double)size / TOOL_SAMPLES, longest);
+  TOOL_PrintStats(&dec.stats);
+}
+
+static void TOOL_CheckVersion(void) {
+  // A newer record with an appended field still decodes, version 0 does not
+  uint8_t record[TELEM_RECORD_SIZE + 2] = {2, 7, 1, 0, 0, 0, 0x34, 0x12,
+                                           0x78, 0x56, 0x03, 0xAA, 0xBB};
+  TELDEC_Stats stats = {0};
+  TELEM_Sample sample;
+  uint16_t crc = TELEM_Crc16(0xFFFF, record, sizeof(record) - 2);
+  record[sizeof(record) - 2] = crc;
+  record[sizeof(record) - 1] = crc >> 8;
+  int ok = TELDEC_ParseRecord(record, sizeof(record), &sample, &stats);
+  TOOL_Expect(ok && sample.sequence == 7 && sample.time == 1 &&
+                  sample.shunt == 0x1234 && sample.bus == 0x5678 &&
+                  sample.flags == 3 && stats.newest == 2,
+              "newer version");
+  record[0] = 0;
+  crc = TELEM_Crc16(0xFFFF, record, sizeof(record) - 2);
+  record[sizeof(record) - 2] = crc;
+  record[sizeof(record) - 1] = crc >> 8;
+  ok = TELDEC_ParseRecord(record, sizeof(record), &sample, &stats);
+  TOOL_Expect(!ok && stats.version == 1, "version 0 rejected");
+  record[0] = TELEM_KIND_BLOCK + 1;
+  crc = TELEM_Crc16(0xFFFF, record, sizeof(record) - 2);
+  record[sizeof(record) - 2] = crc;
+  record[sizeof(record) - 1] = crc >> 8;
+  ok = TELDEC_ParseRecord(record, sizeof(record), &sample, &stats);
+  TOOL_Expect(!ok && stats.version == 2, "unknown kind rejected");
+}
+
+static int TOOL_RoundTrip(const char *path, const char *outPath);
+
+static int TOOL_Check(void) {
+  TOOL_CheckCrc();
+  TOOL_CheckCobs();
+  TOOL_CheckVersion();
+  TOOL_CheckStream(0);
+  TOOL_CheckStream(1);
+  TOOL_Expect(TOOL_RoundTrip(TOOL_CAPTURE, NULL) == 0, "capture round trip");
+  printf("%d failed\n", TOOL_Failures);
+  return TOOL_Failures != 0;
+}
+
+// ---------------------------------------------------------------------------
+// Delta blocks on a recorded capture
+
+static uint8_t *TOOL_ReadFile(const char *path, size_t *size) {
+  FILE *in = fopen(path, "rb");
+  if (in == NULL) {
+    perror(path);
+    exit(1);
+  }
+  fseek(in, 0, SEEK_END);
+  *size = ftell(in);
+  rewind(in);
+  uint8_t *data = malloc(*size ? *size : 1);
+  if (fread(data, 1, *size, in) != *size) {
+    perror(path);
+    exit(1);
+  }
+  fclose(in);
+  return data;
+}
+
+// Decodes a whole stream into a new array. Returns the sample count.
+static size_t TOOL_DecodeAll(const uint8_t *data, size_t size,
+                             TELEM_Sample **out, TELDEC_Stats *stats) {
+  size_t count = 0, capacity = 1024;
+  TELDEC_Decoder dec;
+  TELDEC_Init(&dec);
+  *out = malloc(capacity * sizeof(**out));
+  for (size_t i = 0; i < size; i++) {
+    if (count + TELDEC_MAX_SAMPLES > capacity) {
+      capacity *= 2;
+      *out = realloc(*out, capacity * sizeof(**out));
+    }
+    count += TELDEC_Push(&dec, data[i], *out + count);
+  }
+  *stats = dec.stats;
+  return count;
+}
+
+static int TOOL_RoundTrip(const char *path, const char *outPath) {
+  size_t size;
+  uint8_t *data = TOOL_ReadFile(path, &size);
+  TELEM_Sample *samples, *back;
+  TELDEC_Stats stats, packedStats;
+  size_t count = TOOL_DecodeAll(data, size, &samples, &stats);
+  TOOL_PrintStats(&stats);
+  if (count == 0) {
+    fprintf(stderr, "%s: no samples\n", path);
+    return 1;
+  }
+
+  // Pack as the firmware does, which knows the time to the next sample, and
+  // close a block early at a gap in the sequence numbers, which a block
+  // cannot express
+  static TELEM_Block block;
+  uint8_t *packed = malloc(count * TELEM_BLOCK_FRAME_SIZE);
+  size_t packedSize = 0;
+  TELEM_InitBlock(&block);
+  for (size_t i = 0; i < count; i++) {
+    if (block.count && samples[i].sequence != (uint8_t)(block.last.sequence + 1)) {
+      packedSize += TELEM_EncodeBlock(packed + packedSize, &block);
+    }
+    uint32_t next = i + 1 < count ? samples[i + 1].time - samples[i].time : 0;
+    if (TELEM_AddSample(&block, &samples[i], next)) {
+      packedSize += TELEM_EncodeBlock(packed + packedSize, &block);
+    }
+  }
+  packedSize += TELEM_EncodeBlock(packed + packedSize, &block);
+
+  size_t backCount = TOOL_DecodeAll(packed, packedSize, &back, &packedStats);
+  size_t wrong = backCount == count ? 0 : 1;
+  for (size_t i = 0; i < count && i < backCount; i++) {
+    wrong += !TOOL_SameSample(&samples[i], &back[i]);
+  }
+  TOOL_PrintStats(&packedStats);
+  // 10 bits per byte on the wire, 8N1
+  double perRecord = (double)size / count, perBlock = (double)packedSize / count;
+  printf("%zu samples: %.2f bytes each as records, %.2f as blocks, %.2fx\n",
+         count, perRecord, perBlock, perRecord / perBlock);
+  printf("at 115200 baud: %.0f samples/s as records, %.0f as blocks\n",
+         11520 / perRecord, 11520 / perBlock);
+  printf("%s\n", wrong ? "FAIL round trip differs" : "round trip lossless");
+
+  if (outPath) {
+    FILE *out = fopen(outPath, "wb");
+    if (out == NULL) {
+      perror(outPath);
+      return 1;
+    }
+    fwrite(packed, 1, packedSize, out);
+    fclose(out);
+  }
+  free(data);
+  free(samples);
+  free(back);
+  free(packed);
+  return wrong != 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc >= 2 && argc <= 3 && strcmp(argv[1], "decode") == 0) {
+    return TOOL_Decode(argc == 3 ? argv[2] : NULL);
+  }
+  if (argc == 2 && strcmp(argv[1], "check") == 0) {
+    return TOOL_Check();
+  }
+  if ((argc == 3 || argc == 4) && strcmp(argv[1], "roundtrip") == 0) {
+    return TOOL_RoundTrip(argv[2], argc == 4 ? argv[3] : NULL);
+  }
+  fprintf(stderr, "usage: %s decode [FILE] | check | roundtrip FILE [OUT]\n",
+          argv[0]);
+  return 2;
+}
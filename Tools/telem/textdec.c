@@ -0,0 +1,98 @@
+#include "textdec.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const struct {
+  const char *key;
+  const char *unit;
+  uint8_t field;
+  size_t offset;
+} TXTDEC_Fields[] = {
+    {"Shunt Voltage: ", " uV", TXTDEC_FIELD_SHUNT,
+     offsetof(TXTDEC_Report, shunt)},
+    {"Bus Voltage: ", " mV", TXTDEC_FIELD_BUS, offsetof(TXTDEC_Report, bus)},
+    {"Current: ", " mA", TXTDEC_FIELD_CURRENT,
+     offsetof(TXTDEC_Report, current)},
+    {"Power: ", " mW", TXTDEC_FIELD_POWER, offsetof(TXTDEC_Report, power)},
+    {"Energy: ", " mWh", TXTDEC_FIELD_ENERGY, 0},
+};
+#define TXTDEC_FIELD_COUNT (sizeof(TXTDEC_Fields) / sizeof(TXTDEC_Fields[0]))
+#define TXTDEC_REQUIRED                                                        \
+  (TXTDEC_FIELD_SHUNT | TXTDEC_FIELD_BUS | TXTDEC_FIELD_CURRENT |              \
+   TXTDEC_FIELD_POWER)
+
+void TXTDEC_Init(TXTDEC_Decoder *dec) {
+  memset(dec, 0, sizeof(*dec));
+  dec->energy = -1;
+}
+
+int TXTDEC_ParseLine(TXTDEC_Decoder *dec, const char *line,
+                     TXTDEC_Report *report) {
+  dec->stats.lines++;
+  for (size_t i = 0; i < TXTDEC_FIELD_COUNT; i++) {
+    size_t keyLen = strlen(TXTDEC_Fields[i].key);
+    if (strncmp(line, TXTDEC_Fields[i].key, keyLen) != 0) {
+      continue;
+    }
+    char *end;
+    long value = strtol(line + keyLen, &end, 10);
+    if (end == line + keyLen || strcmp(end, TXTDEC_Fields[i].unit) != 0) {
+      dec->stats.malformed++;
+      return 0;
+    }
+    uint8_t field = TXTDEC_Fields[i].field;
+    if (field == TXTDEC_FIELD_ENERGY) {
+      dec->energy = value;
+      return 0;
+    }
+    // The shunt voltage opens a report
+    if (field == TXTDEC_FIELD_SHUNT) {
+      memset(&dec->report, 0, sizeof(dec->report));
+    }
+    *(int32_t *)((char *)&dec->report + TXTDEC_Fields[i].offset) = value;
+    dec->report.fields |= field;
+    if (field != TXTDEC_FIELD_POWER) {
+      return 0;
+    }
+    // Fields of this report never count towards the next one
+    uint8_t complete = (dec->report.fields & TXTDEC_REQUIRED) == TXTDEC_REQUIRED;
+    if (complete) {
+      *report = dec->report;
+      dec->stats.reports++;
+    } else {
+      dec->stats.partial++;
+    }
+    memset(&dec->report, 0, sizeof(dec->report));
+    return complete;
+  }
+  dec->stats.other++;
+  return 0;
+}
+
+int TXTDEC_Push(TXTDEC_Decoder *dec, uint8_t byte, TXTDEC_Report *report) {
+  dec->stats.bytes++;
+  if (byte == '\r') {
+    return 0;
+  }
+  if (byte != '\n') {
+    if (dec->len < TXTDEC_MAX_LINE) {
+      dec->line[dec->len++] = byte;
+    } else {
+      dec->overflow = 1;
+    }
+    return 0;
+  }
+
+  int ok = 0;
+  if (dec->overflow) {
+    dec->stats.overlong++;
+  } else if (dec->len > 0) {
+    dec->line[dec->len] = '\0';
+    ok = TXTDEC_ParseLine(dec, dec->line, report);
+  }
+  dec->len = 0;
+  dec->overflow = 0;
+  return ok;
+}
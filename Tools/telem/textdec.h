@@ -0,0 +1,58 @@
+#pragma once
+
+// Host decoder of the text reports of Src/main.c:
+//
+//   Shunt Voltage: 1230 uV
+//   Bus Voltage: 5012 mV
+//   Current: 615 mA
+//   Power: 3082 mW
+//   Energy: 12 mWh
+//
+// A report is complete at its Power line, the device's energy total that
+// follows is kept apart. Other lines (alarms, periods, diagnostics, shell
+// replies) are counted and skipped, as is a report that misses a field.
+
+#include <stdint.h>
+
+#define TXTDEC_MAX_LINE 128
+
+#define TXTDEC_FIELD_SHUNT 0x01
+#define TXTDEC_FIELD_BUS 0x02
+#define TXTDEC_FIELD_CURRENT 0x04
+#define TXTDEC_FIELD_POWER 0x08
+#define TXTDEC_FIELD_ENERGY 0x10
+
+typedef struct TXTDEC_Report {
+  int32_t shunt;   // uV
+  int32_t bus;     // mV
+  int32_t current; // mA
+  int32_t power;   // mW
+  uint8_t fields;  // TXTDEC_FIELD_* present
+} TXTDEC_Report;
+
+typedef struct TXTDEC_Stats {
+  uint64_t bytes;
+  uint64_t lines;
+  uint64_t reports;   // complete reports
+  uint64_t other;     // lines that are not report fields
+  uint32_t malformed; // report fields without a number
+  uint32_t partial;   // reports missing a field
+  uint32_t overlong;  // lines longer than TXTDEC_MAX_LINE
+} TXTDEC_Stats;
+
+typedef struct TXTDEC_Decoder {
+  char line[TXTDEC_MAX_LINE + 1];
+  uint16_t len;
+  uint8_t overflow; // line too long, skip to its end
+  TXTDEC_Report report; // being assembled
+  int32_t energy;       // mWh since power-up, last Energy line, -1 before
+  TXTDEC_Stats stats;
+} TXTDEC_Decoder;
+
+void TXTDEC_Init(TXTDEC_Decoder *dec);
+// Feeds one byte. Returns 1 when it completes a report, written to *report.
+int TXTDEC_Push(TXTDEC_Decoder *dec, uint8_t byte, TXTDEC_Report *report);
+// Parses one line without its line end into the report being assembled.
+// Returns 1 if it completed the report.
+int TXTDEC_ParseLine(TXTDEC_Decoder *dec, const char *line,
+                     TXTDEC_Report *report);